@@ -0,0 +1,420 @@
+//#define CHUNKER
+#ifdef CHUNKER
+
+/* Content-defined chunking */
+
+/* Splits a file into chunks whose boundaries depend on the content, and not on offsets,
+so that an insertion or deletion changes only the chunks around it, and the rest
+deduplicate against an earlier version of the file.
+
+A rolling fingerprint of the last WINDOW bytes is computed at every position,
+and a chunk is cut where the fingerprint is below a threshold, which happens with probability 1 / (avgSize - minSize).
+Chunks are at least minSize and at most maxSize bytes long, and about avgSize on average
+(a bit less, since the chunks that would be longer than maxSize are cut there).
+
+The fingerprint is a Gear hash (as in FastCDC), which is a Buzhash without the removal step:
+    h = (h << 1) + G[in]
+where G is a table of 256 random 64-bit values. A byte is shifted out of the top after WINDOW == 64 steps,
+so h depends only on the last 64 bytes, and its high bits, which decide the comparison with the threshold,
+on many of them.
+It's rolled like the window hash in "Find Pattern in Text", but one step is a shift and an add
+(one LEA on x86), instead of multiplications modulo a prime, or two rotations and two XORs of Buzhash.
+The first minSize - WINDOW bytes of every chunk are skipped, since a chunk can't be cut there.
+
+The file is read through a buffer of BUF_SIZE bytes, so memory is bounded whatever the file size.
+Every chunk is emitted as (offset, length, SHA-256 of the content).
+SHA-256 uses the SHA extensions of x86 CPUs when they are there (chosen at run-time),
+since the portable code is several times slower than the chunker.
+
+With -b, the file is read into memory and chunked with and without SHA-256, and the throughputs are printed. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SHA
+#else
+#include <cpuid.h>
+#define TARGET_SHA __attribute__((target("sha,sse4.1")))
+#endif // _MSC_VER
+#endif // X86
+
+#define WINDOW 64                                               // Number of bytes the fingerprint depends on; the width of h.
+#define MIN_SIZE 2048                                           // Default chunk sizes
+#define AVG_SIZE 8192
+#define MAX_SIZE 65536
+#define BUF_SIZE (1u << 22)                                     // Must be at least maxSize.
+#define SEED 0x2545f4914f6cdd1dllu                              // The table G must be the same in every run, or chunks wouldn't deduplicate.
+
+typedef unsigned long long ull;
+typedef unsigned int uint;
+
+static ull G[256];
+
+/* Fills G from splitmix64 (http://xorshift.di.unimi.it/splitmix64.c), with a fixed seed. */
+void initTable(void) {
+    ull state = SEED;
+    for (int i = 0; i < 256; i++) {
+        ull z = (state += 0x9e3779b97f4a7c15llu);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9llu;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebllu;
+        G[i] = z ^ (z >> 31);
+    }
+}
+
+
+/* SHA-256 CODE */
+
+/* https://en.wikipedia.org/wiki/SHA-2 */
+
+static const uint K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(v, r) (((v) >> (r)) | ((v) << (32 - (r))))
+
+/* Processes numBlocks 64-byte blocks, in portable C. */
+void sha256BlocksScalar(uint *state, const unsigned char *p, size_t numBlocks) {
+    for ( ; numBlocks; numBlocks--, p += 64) {
+        uint w[64];
+        for (int i = 0; i < 16; i++)
+            w[i] = (uint)p[4 * i] << 24 | (uint)p[4 * i + 1] << 16 | (uint)p[4 * i + 2] << 8 | p[4 * i + 3];
+        for (int i = 16; i < 64; i++) {
+            uint s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint a = state[0], b = state[1], c = state[2], d = state[3];
+        uint e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+            uint t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef X86
+/* Processes numBlocks 64-byte blocks, with the SHA extensions.
+SHA_ROUNDS does 4 rounds with 4 words of the message schedule; SHA_SCHEDULE computes the next 4 words
+from the previous 16, which are kept in w0..w3. The state is kept as (A, B, E, F) and (C, D, G, H),
+which is the order that sha256rnds2 works with. */
+#define SHA_ROUNDS(w, k) \
+    msg = _mm_add_epi32(w, _mm_loadu_si128((const __m128i *)(K256 + (k)))); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+
+#define SHA_SCHEDULE(w0, w1, w2, w3) \
+    w0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4)), w3);
+
+TARGET_SHA
+void sha256BlocksSHANI(uint *state, const unsigned char *p, size_t numBlocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0xb1);           // C D A B
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(state + 4)), 0x1b);  // E F G H
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);                                          // A B E F
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);                                               // C D G H
+
+    for ( ; numBlocks; numBlocks--, p += 64) {
+        __m128i save0 = state0, save1 = state1, msg;
+        __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p), byteSwap);
+        __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 16)), byteSwap);
+        __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 32)), byteSwap);
+        __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 48)), byteSwap);
+        SHA_ROUNDS(w0, 0)
+        SHA_ROUNDS(w1, 4)
+        SHA_ROUNDS(w2, 8)
+        SHA_ROUNDS(w3, 12)
+        for (int k = 16; k < 64; k += 16) {
+            SHA_SCHEDULE(w0, w1, w2, w3)
+            SHA_ROUNDS(w0, k)
+            SHA_SCHEDULE(w1, w2, w3, w0)
+            SHA_ROUNDS(w1, k + 4)
+            SHA_SCHEDULE(w2, w3, w0, w1)
+            SHA_ROUNDS(w2, k + 8)
+            SHA_SCHEDULE(w3, w0, w1, w2)
+            SHA_ROUNDS(w3, k + 12)
+        }
+        state0 = _mm_add_epi32(state0, save0);
+        state1 = _mm_add_epi32(state1, save1);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);                      // F E B A
+    state1 = _mm_shuffle_epi32(state1, 0xb1);                   // D C H G
+    _mm_storeu_si128((__m128i *)state, _mm_blend_epi16(tmp, state1, 0xf0));         // D C B A
+    _mm_storeu_si128((__m128i *)(state + 4), _mm_alignr_epi8(state1, tmp, 8));       // H G F E
+}
+#endif // X86
+
+static void (*sha256Blocks)(uint *state, const unsigned char *p, size_t numBlocks) = sha256BlocksScalar;
+
+/* Chooses sha256BlocksSHANI() if the CPU has the SHA extensions (and SSE4.1, which it uses too). */
+void initSHA256(void) {
+#ifdef X86
+    int hasSHA, hasSSE41;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return;
+    __cpuidex(info, 1, 0);
+    hasSSE41 = (info[2] >> 19) & 1;
+    __cpuidex(info, 7, 0);
+    hasSHA = (info[1] >> 29) & 1;
+#else
+    uint a, b, c, d;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+        return;
+    hasSHA = (b >> 29) & 1;
+    __get_cpuid(1, &a, &b, &c, &d);
+    hasSSE41 = (c >> 19) & 1;
+#endif // _MSC_VER
+    if (hasSHA && hasSSE41)
+        sha256Blocks = sha256BlocksSHANI;
+#endif // X86
+}
+
+/* SHA-256 of p[0..n), into digest. */
+void sha256(const unsigned char *p, size_t n, unsigned char digest[32]) {
+    uint state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    size_t i = n & ~(size_t)63;
+    sha256Blocks(state, p, n / 64);
+
+    /* Padding: 0x80, zeros, and the length in bits, as a big-endian 64-bit number. */
+    unsigned char last[128] = { 0 };
+    size_t rest = n - i;
+    memcpy(last, p + i, rest);
+    last[rest] = 0x80;
+    size_t lastLen = rest + 9 <= 64 ? 64 : 128;
+    ull bits = (ull)n * 8;
+    for (int k = 0; k < 8; k++)
+        last[lastLen - 1 - k] = (unsigned char)(bits >> (8 * k));
+    sha256Blocks(state, last, lastLen / 64);
+
+    for (int k = 0; k < 8; k++) {
+        digest[4 * k] = (unsigned char)(state[k] >> 24);
+        digest[4 * k + 1] = (unsigned char)(state[k] >> 16);
+        digest[4 * k + 2] = (unsigned char)(state[k] >> 8);
+        digest[4 * k + 3] = (unsigned char)state[k];
+    }
+}
+
+
+/* CHUNKER CODE */
+
+typedef struct Chunker Chunker;
+
+struct Chunker {
+    size_t minSize, maxSize;
+    ull threshold;                                              // a chunk is cut where h < threshold
+};
+
+/* minSize must be at least WINDOW, and avgSize greater than minSize.
+After minSize, a chunk is cut at every byte with probability 1 / d, d == avgSize - minSize,
+so its length beyond minSize is geometric, with mean d, and the average chunk is minSize + d == avgSize long,
+less the part of the tail that maxSize cuts off: d * exp(-(maxSize - minSize) / d), which is negligible with the defaults.
+A mask of the top k bits of h would only give probabilities 1 / 2**k, and an average that is off by up to half of d;
+a comparison with 2**64 / d costs the same. */
+Chunker makeChunker(size_t minSize, size_t avgSize, size_t maxSize) {
+    Chunker c;
+    ull d = avgSize > minSize ? avgSize - minSize : 1;
+    c.minSize = minSize < WINDOW ? WINDOW : minSize;
+    c.maxSize = maxSize < c.minSize ? c.minSize : maxSize;
+    c.threshold = d > 1 ? ~0llu / d : ~0llu;
+    return c;
+}
+
+/* One step of the Gear hash, and a cut after byte j if the fingerprint matches. */
+#define GEAR_STEP(j) \
+    h = (h << 1) + G[p[j]]; \
+    if (h < threshold) \
+        return (j) + 1;
+
+/* Returns the length of the chunk that starts at p, where n bytes are available.
+If n is less than maxSize, the caller must have reached the end of the file.
+The fingerprint starts from 0, WINDOW bytes before minSize, so by minSize it depends only on the window,
+and not on where the chunk started; that's what makes the cut points line up again after an edit.
+The loop is unrolled 4 times, since the fingerprint itself takes only about a cycle per byte. */
+size_t findCut(const Chunker *c, const unsigned char *p, size_t n) {
+    size_t end = n < c->maxSize ? n : c->maxSize;
+    if (end <= c->minSize)
+        return end;
+
+    const ull threshold = c->threshold;
+    ull h = 0;
+    size_t j;
+    for (j = c->minSize - WINDOW; j < c->minSize - 1; j++)
+        h = (h << 1) + G[p[j]];
+
+    for ( ; j + 4 <= end; j += 4) {
+        GEAR_STEP(j)
+        GEAR_STEP(j + 1)
+        GEAR_STEP(j + 2)
+        GEAR_STEP(j + 3)
+    }
+    for ( ; j < end; j++) {
+        GEAR_STEP(j)
+    }
+    return end;
+}
+
+void printChunk(ull offset, const unsigned char *p, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    unsigned char digest[32];
+    char digestHex[65];
+    sha256(p, len, digest);
+    for (int k = 0; k < 32; k++) {
+        digestHex[2 * k] = hex[digest[k] >> 4];
+        digestHex[2 * k + 1] = hex[digest[k] & 15];
+    }
+    digestHex[64] = '\0';
+    printf("%llu %zu %s\n", offset, len, digestHex);
+}
+
+/* Reads f through a buffer of BUF_SIZE bytes, and prints all chunks.
+The buffer is refilled whenever less than maxSize bytes are left in it, so that findCut() always sees
+either a whole maximum-size chunk, or the end of the file. */
+void chunkStream(const Chunker *c, FILE *f) {
+    unsigned char *buf = malloc(BUF_SIZE);
+    if (!buf)                                                   // if malloc fails
+        exit(-1);
+    size_t have = 0, pos = 0, n;
+    ull offset = 0;                                             // offset of buf[pos] in the file
+    int eof = 0;
+
+    for (;;) {
+        if (!eof && have - pos < c->maxSize) {
+            memmove(buf, buf + pos, have - pos);
+            have -= pos;
+            pos = 0;
+            while (have < BUF_SIZE && (n = fread(buf + have, 1, BUF_SIZE - have, f)) > 0)
+                have += n;
+            eof = have < BUF_SIZE;
+        }
+        if (pos == have)
+            break;
+        size_t len = findCut(c, buf + pos, have - pos);
+        printChunk(offset, buf + pos, len);
+        pos += len;
+        offset += len;
+    }
+    free(buf);
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Chunks a file that's already in memory, optionally with SHA-256, and prints the throughput. */
+void benchmark(const Chunker *c, const unsigned char *T, size_t n, int withHash) {
+    unsigned char digest[32];
+    size_t numChunks = 0;
+    double t0 = now();
+    for (size_t pos = 0; pos < n; numChunks++) {
+        size_t len = findCut(c, T + pos, n - pos);
+        if (withHash)
+            sha256(T + pos, len, digest);
+        pos += len;
+    }
+    double diff = now() - t0;
+    printf("%-18s %.3f s, %.3f GB/s, %zu chunks, %.0f bytes on average\n", withHash ? "chunking + SHA-256:" : "chunking:",
+           diff, n / diff * 1e-9, numChunks, numChunks ? (double)n / numChunks : 0.0);
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* Usage: chunker [-b] FILE [MIN AVG MAX]
+FILE can be "-" for stdin (not with -b). */
+int main(int argc, char *argv[]) {
+    int a = 1, bench = 0;
+    if (a < argc && !strcmp(argv[a], "-b")) {
+        bench = 1;
+        a++;
+    }
+    if (a >= argc) {
+        fprintf(stderr, "Usage: chunker [-b] FILE [MIN AVG MAX]\n");
+        return 1;
+    }
+    const char *name = argv[a++];
+    size_t minSize = a < argc ? (size_t)atol(argv[a++]) : MIN_SIZE;
+    size_t avgSize = a < argc ? (size_t)atol(argv[a++]) : AVG_SIZE;
+    size_t maxSize = a < argc ? (size_t)atol(argv[a++]) : MAX_SIZE;
+    if (maxSize > BUF_SIZE)
+        maxSize = BUF_SIZE;
+
+    initTable();
+    initSHA256();
+    Chunker c = makeChunker(minSize, avgSize, maxSize);
+
+    FILE *f = strcmp(name, "-") ? fopen(name, "rb") : stdin;
+    if (!f) {
+        perror(name);
+        return 1;
+    }
+
+    if (bench) {
+        fseek(f, 0, SEEK_END);
+        size_t n = (size_t)ftell(f);
+        fseek(f, 0, SEEK_SET);
+        unsigned char *T = malloc(n ? n : 1);
+        if (!T || fread(T, 1, n, f) != n)
+            exit(-1);
+        benchmark(&c, T, n, 0);
+        benchmark(&c, T, n, 1);
+        free(T);
+    }
+    else
+        chunkStream(&c, f);
+
+    if (f != stdin)
+        fclose(f);
+    return 0;
+}
+
+/* Test data:
+
+Output has one row per chunk: its offset, its length, and SHA-256 of its content.
+
+Input (printf abc > abc.txt; chunker abc.txt):
+Output:
+0 3 ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad
+
+Input (chunker -b big.bin):
+Output:
+chunking:          ... s, ... GB/s, ... chunks, ... bytes on average
+chunking + SHA-256: ...
+*/
+
+#endif // CHUNKER
@@ -0,0 +1,505 @@
+//#define DELTA
+#ifdef DELTA
+
+/* rsync-style delta encoding */
+
+/* Computes the difference between an old file and a new file as a stream of COPY and INSERT commands,
+without having both files in the same place, like rsync (https://rsync.samba.org/tech_report/):
+    1. sig:   the old file is cut into fixed-size blocks, and every block gets a weak and a strong hash (signature),
+    2. diff:  a window of blockSize bytes slides over the new file, and whenever its weak hash is the hash
+              of some old block, and the strong hashes are equal too, the window is replaced by a COPY of that block,
+    3. patch: the new file is rebuilt from the old file and the delta.
+So a block that moved to any offset, not only to a multiple of blockSize, is still found.
+
+The weak hash is the rolling window hash of "Find Pattern in Text" (precomputeHashes()), rolled forward
+    h = h*X + new[i + blockSize] - X**blockSize * new[i]
+modulo 2**32, so that it's O(1) per byte, and the modulo division is free. X is odd and != 1, so that,
+unlike with x == 1, permuted bytes don't collide. The strong hash is SHA-256,
+which is computed for the window only on a weak hit.
+Old blocks are indexed by weak hash in a chained hash table (head[] and next[]), so the whole diff takes
+O(lenNew) expected time: the window moves by one byte after a miss, and by a whole block after a match.
+
+Only whole blocks of the old file are indexed; a shorter last block is sent as INSERT, if it's still there. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+#define _FILE_OFFSET_BITS 64                                    // 64-bit off_t for fseeko(), on 32-bit POSIX systems, too
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE 2048                                         // Default block size
+#define X 0x01000193u                                           // Multiplier; odd, so that it's invertible modulo 2**32.
+#define GOLDEN 0x9e3779b97f4a7c15llu                            // 2**64 / golden ratio; spreads weak hashes over the buckets
+#define READ_CHUNK (1u << 20)
+#define COPY_BUF_SIZE (1u << 16)
+
+typedef unsigned long long ull;
+typedef unsigned int uint;
+
+
+/* SHA-256 CODE */
+
+/* https://en.wikipedia.org/wiki/SHA-2 (the portable code from "chunker.c") */
+
+static const uint K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(v, r) (((v) >> (r)) | ((v) << (32 - (r))))
+
+/* Processes one 64-byte block. */
+void sha256Block(uint *state, const unsigned char *p) {
+    uint w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint)p[4 * i] << 24 | (uint)p[4 * i + 1] << 16 | (uint)p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint a = state[0], b = state[1], c = state[2], d = state[3];
+    uint e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+        uint t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/* SHA-256 of p[0..n), into digest. */
+void sha256(const unsigned char *p, size_t n, unsigned char digest[32]) {
+    uint state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    size_t i;
+    for (i = 0; i + 64 <= n; i += 64)
+        sha256Block(state, p + i);
+
+    /* Padding: 0x80, zeros, and the length in bits, as a big-endian 64-bit number. */
+    unsigned char last[128] = { 0 };
+    size_t rest = n - i;
+    memcpy(last, p + i, rest);
+    last[rest] = 0x80;
+    size_t lastLen = rest + 9 <= 64 ? 64 : 128;
+    ull bits = (ull)n * 8;
+    for (int k = 0; k < 8; k++)
+        last[lastLen - 1 - k] = (unsigned char)(bits >> (8 * k));
+    sha256Block(state, last);
+    if (lastLen == 128)
+        sha256Block(state, last + 64);
+
+    for (int k = 0; k < 8; k++) {
+        digest[4 * k] = (unsigned char)(state[k] >> 24);
+        digest[4 * k + 1] = (unsigned char)(state[k] >> 16);
+        digest[4 * k + 2] = (unsigned char)(state[k] >> 8);
+        digest[4 * k + 3] = (unsigned char)state[k];
+    }
+}
+
+
+/* WEAK HASH CODE */
+
+/* Hash of p[0..n).
+h = p[0]*X**(n-1) + p[1]*X**(n-2) + ... + p[n-1], modulo 2**32, so that it can be rolled forward. */
+uint weakHash(const unsigned char *p, size_t n) {
+    uint h = 0;
+    for (size_t i = 0; i < n; i++)
+        h = h * X + p[i];
+    return h;
+}
+
+
+/* SIGNATURE CODE */
+
+typedef struct Signature Signature;
+
+struct Signature {
+    size_t blockSize;
+    ull lenOld;                                                 // length of the old file
+    size_t numBlocks;                                           // number of whole blocks
+    uint *weak;
+    unsigned char (*strong)[32];
+    int bits;                                                   // number of buckets == 2**bits
+    long *head;                                                 // first block in a bucket, or -1
+    long *next;                                                 // next block in the same bucket, or -1
+};
+
+Signature *makeSignature(size_t blockSize, ull lenOld, size_t numBlocks) {
+    Signature *s = malloc(sizeof(*s));
+    if (!s)                                                     // if malloc fails
+        exit(-1);
+    s->blockSize = blockSize;
+    s->lenOld = lenOld;
+    s->numBlocks = numBlocks;
+    s->weak = malloc((numBlocks ? numBlocks : 1) * sizeof(*s->weak));
+    s->strong = malloc((numBlocks ? numBlocks : 1) * sizeof(*s->strong));
+    s->head = NULL;
+    s->next = NULL;
+    if (!s->weak || !s->strong)
+        exit(-1);
+    return s;
+}
+
+void freeSignature(Signature *s) {
+    free(s->weak);
+    free(s->strong);
+    free(s->head);
+    free(s->next);
+    free(s);
+}
+
+size_t bucketOf(const Signature *s, uint h) {
+    return (size_t)((h * GOLDEN) >> (64 - s->bits));
+}
+
+/* Builds the chained hash table of blocks by weak hash; at least as many buckets as blocks.
+Blocks are inserted in reverse order, so that the chains are in file order, and the first one of equal blocks is used. */
+void indexSignature(Signature *s) {
+    for (s->bits = 1; ((size_t)1 << s->bits) < s->numBlocks; s->bits++)
+        ;
+    s->head = malloc(((size_t)1 << s->bits) * sizeof(*s->head));
+    s->next = malloc((s->numBlocks ? s->numBlocks : 1) * sizeof(*s->next));
+    if (!s->head || !s->next)
+        exit(-1);
+    memset(s->head, -1, ((size_t)1 << s->bits) * sizeof(*s->head));
+    for (size_t b = s->numBlocks; b-- > 0; ) {
+        size_t k = bucketOf(s, s->weak[b]);
+        s->next[b] = s->head[k];
+        s->head[k] = (long)b;
+    }
+}
+
+/* Reads f one block at a time, and prints its signature:
+a row "blockSize lenOld numBlocks", and a row "weak strong" per whole block, in hex. */
+void printSignature(FILE *f, size_t blockSize) {
+    static const char hex[] = "0123456789abcdef";
+    unsigned char *block = malloc(blockSize);
+    unsigned char digest[32];
+    char digestHex[65];
+    if (!block)                                                 // if malloc fails
+        exit(-1);
+
+    /* The header needs the length before the rows, so the rows go to a temporary file. */
+    FILE *rows = tmpfile();
+    if (!rows)
+        exit(-1);
+    ull lenOld = 0;
+    size_t numBlocks = 0, n;
+    while ((n = fread(block, 1, blockSize, f)) > 0) {
+        lenOld += n;
+        if (n < blockSize)
+            break;
+        sha256(block, n, digest);
+        for (int k = 0; k < 32; k++) {
+            digestHex[2 * k] = hex[digest[k] >> 4];
+            digestHex[2 * k + 1] = hex[digest[k] & 15];
+        }
+        digestHex[64] = '\0';
+        fprintf(rows, "%08x %s\n", weakHash(block, n), digestHex);
+        numBlocks++;
+    }
+
+    printf("%zu %llu %zu\n", blockSize, lenOld, numBlocks);
+    rewind(rows);
+    while ((n = fread(block, 1, blockSize, rows)) > 0)
+        fwrite(block, 1, n, stdout);
+    fclose(rows);
+    free(block);
+}
+
+int hexDigit(int c) {
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+/* Reads a signature printed by printSignature(), and indexes it. Returns NULL if it's malformed. */
+Signature *readSignature(FILE *f) {
+    size_t blockSize, numBlocks;
+    ull lenOld;
+    char digestHex[65];
+    if (fscanf(f, "%zu %llu %zu", &blockSize, &lenOld, &numBlocks) != 3 || !blockSize)
+        return NULL;
+    Signature *s = makeSignature(blockSize, lenOld, numBlocks);
+    for (size_t b = 0; b < numBlocks; b++) {
+        if (fscanf(f, "%x %64s", &s->weak[b], digestHex) != 2 || strlen(digestHex) != 64) {
+            freeSignature(s);
+            return NULL;
+        }
+        for (int k = 0; k < 32; k++)
+            s->strong[b][k] = (unsigned char)(hexDigit(digestHex[2 * k]) << 4 | hexDigit(digestHex[2 * k + 1]));
+    }
+    indexSignature(s);
+    return s;
+}
+
+
+/* DELTA CODE */
+
+/* The delta is a row "DELTA blockSize lenNew", followed by commands:
+    C first count\n             - copy count blocks of the old file, starting with block first,
+    I len\n<len raw bytes>      - insert len bytes.
+Consecutive blocks are merged into one COPY, and pending literal bytes into one INSERT. */
+typedef struct DeltaWriter DeltaWriter;
+
+struct DeltaWriter {
+    FILE *out;
+    size_t copyFirst, copyCount;                                // pending COPY, if copyCount > 0
+    ull copied, inserted;                                       // statistics, in bytes
+    size_t numCopies, numInserts;
+};
+
+void flushCopy(DeltaWriter *w) {
+    if (w->copyCount) {
+        fprintf(w->out, "C %zu %zu\n", w->copyFirst, w->copyCount);
+        w->numCopies++;
+        w->copyCount = 0;
+    }
+}
+
+void emitInsert(DeltaWriter *w, const unsigned char *p, size_t len) {
+    if (!len)
+        return;
+    flushCopy(w);
+    fprintf(w->out, "I %zu\n", len);
+    fwrite(p, 1, len, w->out);
+    w->inserted += len;
+    w->numInserts++;
+}
+
+void emitCopy(DeltaWriter *w, size_t block, size_t blockSize) {
+    if (w->copyCount && w->copyFirst + w->copyCount == block)
+        w->copyCount++;
+    else {
+        flushCopy(w);
+        w->copyFirst = block;
+        w->copyCount = 1;
+    }
+    w->copied += blockSize;
+}
+
+/* Returns the old block that's equal to N[i..i+blockSize), whose weak hash is h, or -1.
+The strong hash of the window is computed only if some block has the same weak hash. */
+long findBlock(const Signature *s, const unsigned char *N, size_t i, uint h) {
+    unsigned char digest[32];
+    int haveDigest = 0;
+    for (long b = s->head[bucketOf(s, h)]; b != -1; b = s->next[b]) {
+        if (s->weak[b] != h)
+            continue;
+        if (!haveDigest) {
+            sha256(N + i, s->blockSize, digest);
+            haveDigest = 1;
+        }
+        if (!memcmp(digest, s->strong[b], 32))
+            return b;
+    }
+    return -1;
+}
+
+/* Writes the delta that turns the old file of signature s into N[0..lenN), to w. */
+void computeDelta(const Signature *s, const unsigned char *N, size_t lenN, DeltaWriter *w) {
+    size_t B = s->blockSize;
+    fprintf(w->out, "DELTA %zu %zu\n", B, lenN);
+    size_t pending = 0;                                         // start of the bytes that aren't in the delta yet
+
+    if (s->numBlocks && lenN >= B) {
+        uint y = 1;                                             // y == X**B is the weight that the byte leaving the window would have
+        for (size_t k = 0; k < B; k++)
+            y *= X;
+
+        size_t i = 0;
+        uint h = weakHash(N, B);
+        for (;;) {
+            long b = findBlock(s, N, i, h);
+            if (b != -1) {
+                emitInsert(w, N + pending, i - pending);
+                emitCopy(w, (size_t)b, B);
+                i += B;
+                pending = i;
+                if (i + B > lenN)
+                    break;
+                h = weakHash(N + i, B);                         // a match skips a whole block, so the window is rehashed
+            }
+            else {
+                if (i + B == lenN)
+                    break;
+                h = h * X + N[i + B] - y * N[i];
+                i++;
+            }
+        }
+    }
+
+    emitInsert(w, N + pending, lenN - pending);
+    flushCopy(w);
+}
+
+/* Copies n bytes from in to out. Returns FALSE if in ends first. */
+int copyBytes(FILE *in, FILE *out, ull n) {
+    static unsigned char buf[COPY_BUF_SIZE];
+    while (n) {
+        size_t k = n < COPY_BUF_SIZE ? (size_t)n : COPY_BUF_SIZE;
+        if (fread(buf, 1, k, in) != k)
+            return 0;
+        fwrite(buf, 1, k, out);
+        n -= k;
+    }
+    return 1;
+}
+
+/* fseek() to a 64-bit offset. fseek() takes a long, which has only 32 bits on Windows and on 32-bit systems,
+so offsets past 2 GiB in the old file would be truncated.
+Returns 0 on success, like fseek(). */
+int seekTo(FILE *f, ull offset) {
+#ifdef _MSC_VER
+    return _fseeki64(f, (long long)offset, SEEK_SET);
+#else
+    if ((ull)(off_t)offset != offset)
+        return -1;
+    return fseeko(f, (off_t)offset, SEEK_SET);
+#endif // _MSC_VER
+}
+
+/* Rebuilds the new file from the old file and the delta, and writes it to out.
+Returns FALSE if the delta is malformed, or doesn't fit the old file. */
+int applyDelta(FILE *old, FILE *delta, FILE *out) {
+    size_t blockSize, a, b;
+    ull lenNew, written = 0;
+    char cmd;
+    if (fscanf(delta, "DELTA %zu %llu", &blockSize, &lenNew) != 2 || getc(delta) != '\n')
+        return 0;
+    while (fscanf(delta, " %c", &cmd) == 1) {
+        if (cmd == 'C') {
+            if (fscanf(delta, "%zu %zu", &a, &b) != 2 || seekTo(old, (ull)a * blockSize)
+                || !copyBytes(old, out, (ull)b * blockSize))
+                return 0;
+            written += (ull)b * blockSize;
+        }
+        else if (cmd == 'I') {
+            if (fscanf(delta, "%zu", &a) != 1 || getc(delta) != '\n' || !copyBytes(delta, out, a))
+                return 0;
+            written += a;
+        }
+        else
+            return 0;
+    }
+    return written == lenNew;
+}
+
+/* Reads all of f into memory. */
+unsigned char *readAll(FILE *f, size_t *len) {
+    size_t cap = READ_CHUNK, n;
+    unsigned char *buf = malloc(cap);
+    *len = 0;
+    while (buf && (n = fread(buf + *len, 1, cap - *len, f)) > 0) {
+        *len += n;
+        if (*len == cap)
+            buf = realloc(buf, cap <<= 1);
+    }
+    if (!buf)                                                   // if malloc or realloc fails
+        exit(-1);
+    return buf;
+}
+
+FILE *openFile(const char *name, const char *mode) {
+    FILE *f = fopen(name, mode);
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    return f;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* Usage:
+delta sig OLD [BLOCK_SIZE] > SIG
+delta diff SIG NEW > DELTA
+delta patch OLD DELTA > NEW
+Statistics of diff go to stderr. */
+int main(int argc, char *argv[]) {
+    if (argc < 3 || (strcmp(argv[1], "sig") && argc < 4)) {
+        fprintf(stderr, "Usage: delta sig OLD [BLOCK_SIZE] | delta diff SIG NEW | delta patch OLD DELTA\n");
+        return 1;
+    }
+
+    if (!strcmp(argv[1], "sig")) {
+        size_t blockSize = argc > 3 ? (size_t)atol(argv[3]) : BLOCK_SIZE;
+        FILE *old = openFile(argv[2], "rb");
+        printSignature(old, blockSize ? blockSize : BLOCK_SIZE);
+        fclose(old);
+    }
+    else if (!strcmp(argv[1], "diff")) {
+        FILE *sig = openFile(argv[2], "r");
+        Signature *s = readSignature(sig);
+        fclose(sig);
+        if (!s) {
+            fprintf(stderr, "%s: malformed signature\n", argv[2]);
+            return 1;
+        }
+        FILE *f = openFile(argv[3], "rb");
+        size_t lenN;
+        unsigned char *N = readAll(f, &lenN);
+        fclose(f);
+
+        DeltaWriter w = { stdout, 0, 0, 0, 0, 0, 0 };
+        computeDelta(s, N, lenN, &w);
+        fprintf(stderr, "copied %llu bytes in %zu commands, inserted %llu bytes in %zu commands\n",
+                w.copied, w.numCopies, w.inserted, w.numInserts);
+        free(N);
+        freeSignature(s);
+    }
+    else {                                                      // patch
+        FILE *old = openFile(argv[2], "rb");
+        FILE *delta = openFile(argv[3], "rb");
+        int ok = applyDelta(old, delta, stdout);
+        fclose(old);
+        fclose(delta);
+        if (!ok) {
+            fprintf(stderr, "%s: malformed delta, or it's not for %s\n", argv[3], argv[2]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Test data:
+
+Input:
+printf "The quick brown fox jumps over the lazy dog." > old.txt
+printf "A quick brown fox jumps over the lazy dog!" > new.txt
+delta sig old.txt 8 > sig.txt
+delta diff sig.txt new.txt > delta.bin
+delta patch old.txt delta.bin > out.txt
+Output:
+sig.txt:
+8 44 5
+206e2d59 10ae0f24c936bc39be215f80c343c6e870f640fd56b0aeb842c3cd49a4e6dfa3
+...
+delta.bin (blocks 1..4 of old.txt, "k brown fox jumps over the lazy ", are at offset 6 in new.txt):
+DELTA 8 42
+I 6
+A quicC 1 4
+I 4
+dog!
+out.txt is equal to new.txt.
+*/
+
+#endif // DELTA
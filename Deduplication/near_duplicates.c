@@ -0,0 +1,717 @@
+//#define NEAR_DUPLICATES
+#ifdef NEAR_DUPLICATES
+
+/* Near-duplicate documents */
+
+/* Finds pairs of similar files in a directory tree, without comparing every pair of files.
+Every file is reduced to a small set of fingerprints, and only files that share a fingerprint are compared.
+
+1. Hashes of all k-grams (substrings of length k) are rolled over every file, with the arithmetic
+of "hash_substring_alt.c": modulo 2**61 - 1, with a random base x that's the same for all files.
+Then every file gets either
+    - a MinHash signature (default): for NUM_HASHES bins, the least hash of the k-grams that fall into the bin
+      (one-permutation hashing, so that every k-gram costs O(1), and not O(NUM_HASHES)).
+      Equal values at the same position estimate the Jaccard similarity of the sets of k-grams.
+      Empty bins (short files) borrow the value of the next non-empty bin (densification).
+    - winnowed fingerprints (-w W): the least hash in every window of W consecutive k-gram hashes
+      (https://theory.stanford.edu/~aiken/publications/papers/sigmod03.pdf). Any common substring of length
+      at least W + k - 1 gives two files a common fingerprint.
+Files are fingerprinted in parallel; threads take the next file from a shared counter, since file sizes differ a lot.
+
+2. Fingerprints are indexed in a chained hash table: key -> list of files.
+    - For MinHash, the key is a hash of a band of ROWS consecutive signature values (LSH banding),
+      so files with similarity s share some band with probability 1 - (1 - s**ROWS)**BANDS.
+    - For winnowing, the key is the fingerprint itself.
+Every pair of files in a list is a candidate; a hash set of pairs removes repeated candidates.
+A list of more than MAX_POSTING files would add O(n**2) candidates, so its files are paired only with its first file
+(a star instead of a clique). Such lists are boilerplate, or a cluster of copies, which mustn't be lost:
+the copies share every band and every fingerprint, and they all meet their first file in every one of them.
+So a key adds O(n) candidates, and a cluster of n copies is reported as n - 1 pairs with its first file,
+instead of n*(n - 1)/2 pairs; a file that is similar to the copies is reported with the first file of the lists
+that it shares with them (or, if it's the first file itself, with all the copies).
+
+3. Candidates are verified: MinHash pairs by the fraction of equal signature values,
+and winnowed pairs by the exact Jaccard similarity of their fingerprint sets.
+Pairs with similarity at least THRESHOLD are printed.
+
+Uses POSIX threads and directory functions (link with -pthread). */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef _MSC_VER
+#include <intrin.h>                                             // _umul128()
+#endif // _MSC_VER
+
+#define K 8                                                     // Default length of k-grams
+#define NUM_HASHES 128                                          // Length of a MinHash signature; == BANDS * ROWS
+#define BIN_BITS 7                                              // NUM_HASHES == 2**BIN_BITS
+#define BANDS 32
+#define ROWS 4
+#define MAX_WINNOW 1024                                         // Max window length for winnowing; a power of two
+#define MAX_POSTING 64                                          // Files of a key with more files than this are paired only with its first file.
+#define THRESHOLD 0.5
+#define MAX_THREADS 256
+#define PRIME 2305843009213693951llu                            // 2**61 - 1
+#define POWER 61                                                // PRIME == 2**POWER - 1
+#define M 0x1fffffffffffffffllu
+#define Q 61
+#define R 0x1fffffffffffffffllu
+#define GOLDEN 0x9e3779b97f4a7c15llu                            // 2**64 / golden ratio
+
+typedef unsigned long long ull;
+typedef unsigned int uint;
+
+/* HASH CODE */
+
+/* h % PRIME, for h < 2**(2*POWER).
+http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivision */
+ull reduce(ull h) {
+    /* h % PRIME goes into m (modulus) */
+    ull m;
+
+    m = (h & M) + ((h >> POWER) & M);
+
+    for ( ; m > PRIME; )
+        m = (m >> Q) + (m & R);
+
+    return m == PRIME ? 0 : m;
+}
+
+/* a * b % PRIME, for a, b < PRIME. */
+ull mulMod(ull a, ull b) {
+#ifdef _MSC_VER
+    ull hi, lo = _umul128(a, b, &hi);
+    return reduce((lo & M) + ((lo >> POWER) | (hi << (64 - POWER))));
+#else
+    unsigned __int128 p = (unsigned __int128)a * b;
+    return reduce(((ull)p & M) + (ull)(p >> POWER));
+#endif // _MSC_VER
+}
+
+/* The finalizer of splitmix64 (http://xorshift.di.unimi.it/splitmix64.c).
+k-gram hashes are less than 2**61, so they are mixed before their top bits are used as a bin. */
+ull mix64(ull z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9llu;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebllu;
+    return z ^ (z >> 31);
+}
+
+/* A random base in [2, PRIME - 1]. */
+ull randomBase(void) {
+    ull seed = (ull)time(NULL) ^ ((ull)clock() << 32) ^ (ull)(size_t)&seed;
+    return 2 + mix64(seed + GOLDEN) % (PRIME - 2);
+}
+
+
+/* FINGERPRINT CODE */
+
+typedef struct Document Document;
+
+struct Document {
+    char *path;
+    uint *sig;                                                  // NUM_HASHES MinHash values, or NULL if the file is shorter than k
+    ull *prints;                                                // winnowed fingerprints, sorted and distinct
+    size_t numPrints;
+};
+
+/* Rolls the k-gram hash over T[0..n), and calls EMIT(i, h) for the k-gram at every position i.
+y == x**k is the weight that the byte leaving the window would have. */
+#define ROLL_KGRAMS(T, n, k, x, y, EMIT) \
+    if ((n) >= (size_t)(k)) { \
+        ull h = 0; \
+        for (size_t i = 0; i < (size_t)(k); i++) \
+            h = reduce(mulMod(h, x) + T[i]); \
+        for (size_t i = 0; ; i++) { \
+            EMIT(i, h) \
+            if (i + (k) == (n)) \
+                break; \
+            h = reduce(mulMod(h, x) + T[i + (k)] + PRIME - mulMod(y, T[i])); \
+        } \
+    }
+
+/* MinHash signature of T, by one-permutation hashing. Returns FALSE if T has no k-grams. */
+int minHash(const unsigned char *T, size_t n, int k, ull x, ull y, uint *sig) {
+    ull mins[NUM_HASHES];
+    for (int j = 0; j < NUM_HASHES; j++)
+        mins[j] = ~0llu;
+
+#define MIN_HASH_EMIT(i, h) { \
+        ull v = mix64(h); \
+        size_t bin = (size_t)(v >> (64 - BIN_BITS)); \
+        if (v < mins[bin]) \
+            mins[bin] = v; \
+    }
+    ROLL_KGRAMS(T, n, k, x, y, MIN_HASH_EMIT)
+#undef MIN_HASH_EMIT
+
+    /* Densification: an empty bin borrows from the next non-empty one, and the distance is mixed in,
+    so that two bins that borrow from the same one don't get equal values. */
+    int nonEmpty = -1;
+    for (int j = 0; j < NUM_HASHES; j++) {
+        if (mins[j] != ~0llu) {
+            nonEmpty = j;
+            break;
+        }
+    }
+    if (nonEmpty < 0)
+        return 0;
+    for (int j = 0; j < NUM_HASHES; j++) {
+        int d = 0;
+        while (mins[(j + d) % NUM_HASHES] == ~0llu)
+            d++;
+        ull v = mins[(j + d) % NUM_HASHES];
+        sig[j] = (uint)((d ? mix64(v + (ull)d) : v) >> (32 - BIN_BITS));   // the 32 bits below the bin number
+    }
+    return 1;
+}
+
+int compareULL(const void *a, const void *b) {
+    ull u = *(const ull *)a, v = *(const ull *)b;
+    return u < v ? -1 : u > v;
+}
+
+/* Growable array of fingerprints. */
+typedef struct Prints Prints;
+
+struct Prints {
+    ull *v;
+    size_t len, cap;
+};
+
+void addPrint(Prints *p, ull h) {
+    if (p->len == p->cap) {
+        p->cap = p->cap ? p->cap << 1 : 64;
+        p->v = realloc(p->v, p->cap * sizeof(*p->v));
+        if (!p->v)                                              // if realloc fails
+            exit(-1);
+    }
+    p->v[p->len++] = h;
+}
+
+/* Winnowing: the least k-gram hash of every window of w consecutive ones (the rightmost one, on ties),
+each selected position once. The last w hashes are kept in a ring, and the window is rescanned only
+when its minimum leaves it; a new minimum is expected every O(w) positions, so that's O(1) per k-gram,
+and, unlike with a monotone queue, the branches are predictable. The result is sorted and made distinct. */
+void winnow(const unsigned char *T, size_t n, int k, int w, ull x, ull y, Prints *out) {
+    ull ring[MAX_WINNOW];
+    ull minHash = ~0llu;
+    size_t minPos = 0, lastSelected = (size_t)-1;
+    out->len = 0;
+
+#define WINNOW_EMIT(i, h) { \
+        ull v = mix64(h); \
+        ring[(i) & (MAX_WINNOW - 1)] = v; \
+        if (minPos + w <= (i)) { \
+            minHash = ~0llu; \
+            for (size_t j = (i) + 1 - w; j <= (i); j++) { \
+                if (ring[j & (MAX_WINNOW - 1)] <= minHash) { \
+                    minHash = ring[j & (MAX_WINNOW - 1)]; \
+                    minPos = j; \
+                } \
+            } \
+        } \
+        else if (v <= minHash) { \
+            minHash = v; \
+            minPos = (i); \
+        } \
+        if ((i) + 1 >= (size_t)w && minPos != lastSelected) { \
+            lastSelected = minPos; \
+            addPrint(out, minHash); \
+        } \
+    }
+    ROLL_KGRAMS(T, n, k, x, y, WINNOW_EMIT)
+#undef WINNOW_EMIT
+
+    qsort(out->v, out->len, sizeof(*out->v), compareULL);
+    size_t m = 0;
+    for (size_t i = 0; i < out->len; i++) {
+        if (!m || out->v[i] != out->v[m - 1])
+            out->v[m++] = out->v[i];
+    }
+    out->len = m;
+}
+
+
+/* CORPUS CODE */
+
+typedef struct Corpus Corpus;
+
+struct Corpus {
+    Document *docs;
+    size_t numDocs, cap;
+    int k, w;                                                   // w == 0 for MinHash
+    ull x, y;                                                   // base, and x**k
+    size_t next;                                                // next document to fingerprint
+    pthread_mutex_t lock;
+};
+
+void addDocument(Corpus *c, const char *path) {
+    if (c->numDocs == c->cap) {
+        c->cap = c->cap ? c->cap << 1 : 1024;
+        c->docs = realloc(c->docs, c->cap * sizeof(*c->docs));
+        if (!c->docs)                                           // if realloc fails
+            exit(-1);
+    }
+    Document *d = &c->docs[c->numDocs++];
+    d->path = strdup(path);
+    d->sig = NULL;
+    d->prints = NULL;
+    d->numPrints = 0;
+    if (!d->path)
+        exit(-1);
+}
+
+/* Adds all regular files under dir. Symbolic links aren't followed. */
+void collectFiles(Corpus *c, const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return;
+    }
+    struct dirent *e;
+    struct stat st;
+    size_t lenDir = strlen(dir);
+    char *path = malloc(lenDir + 258);
+    if (!path)                                                  // if malloc fails
+        exit(-1);
+    while ((e = readdir(d))) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, ".."))
+            continue;
+        sprintf(path, "%s/%.255s", dir, e->d_name);
+        if (lstat(path, &st))
+            continue;
+        if (S_ISDIR(st.st_mode))
+            collectFiles(c, path);
+        else if (S_ISREG(st.st_mode))
+            addDocument(c, path);
+    }
+    free(path);
+    closedir(d);
+}
+
+int compareDocuments(const void *a, const void *b) {
+    return strcmp(((const Document *)a)->path, ((const Document *)b)->path);
+}
+
+/* Reads the file into *buf, which grows when needed. Returns its length, or 0 if it can't be read. */
+size_t readInto(const char *path, unsigned char **buf, size_t *cap) {
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (len <= 0) {
+        fclose(f);
+        return 0;
+    }
+    if ((size_t)len > *cap) {
+        *cap = (size_t)len;
+        free(*buf);
+        *buf = malloc(*cap);
+        if (!*buf)                                              // if malloc fails
+            exit(-1);
+    }
+    size_t n = fread(*buf, 1, (size_t)len, f);
+    fclose(f);
+    return n;
+}
+
+/* Thread: fingerprints documents until there are none left. */
+void *fingerprintWorker(void *arg) {
+    Corpus *c = arg;
+    unsigned char *buf = NULL;
+    size_t cap = 0;
+    Prints prints = { NULL, 0, 0 };
+    uint sig[NUM_HASHES];
+
+    for (;;) {
+        pthread_mutex_lock(&c->lock);
+        size_t i = c->next++;
+        pthread_mutex_unlock(&c->lock);
+        if (i >= c->numDocs)
+            break;
+
+        Document *d = &c->docs[i];
+        size_t n = readInto(d->path, &buf, &cap);
+        if (!c->w) {
+            if (minHash(buf, n, c->k, c->x, c->y, sig)) {
+                d->sig = malloc(sizeof(sig));
+                if (!d->sig)                                    // if malloc fails
+                    exit(-1);
+                memcpy(d->sig, sig, sizeof(sig));
+            }
+        }
+        else {
+            winnow(buf, n, c->k, c->w, c->x, c->y, &prints);
+            if (prints.len) {
+                d->prints = malloc(prints.len * sizeof(*d->prints));
+                if (!d->prints)
+                    exit(-1);
+                memcpy(d->prints, prints.v, prints.len * sizeof(*d->prints));
+                d->numPrints = prints.len;
+            }
+        }
+    }
+    free(buf);
+    free(prints.v);
+    return NULL;
+}
+
+void fingerprintAll(Corpus *c, int numThreads) {
+    pthread_t threads[MAX_THREADS];
+    c->next = 0;
+    pthread_mutex_init(&c->lock, NULL);
+    for (int t = 1; t < numThreads; t++) {
+        if (pthread_create(&threads[t], NULL, fingerprintWorker, c))
+            exit(-1);
+    }
+    fingerprintWorker(c);                                       // the main thread is worker 0
+    for (int t = 1; t < numThreads; t++)
+        pthread_join(threads[t], NULL);
+    pthread_mutex_destroy(&c->lock);
+}
+
+
+/* INDEX CODE */
+
+/* Chained hash table of (key, document) entries; the lists of documents per key are the posting lists. */
+typedef struct Postings Postings;
+
+struct Postings {
+    int bits;                                                   // number of buckets == 2**bits
+    long *head;                                                 // first entry in a bucket, or -1
+    long *next;                                                 // next entry in the same bucket, or -1
+    ull *keys;
+    uint *docs;
+    size_t len, cap;
+};
+
+void addEntry(Postings *p, ull key, uint doc) {
+    if (p->len == p->cap) {
+        p->cap = p->cap ? p->cap << 1 : 1024;
+        p->keys = realloc(p->keys, p->cap * sizeof(*p->keys));
+        p->docs = realloc(p->docs, p->cap * sizeof(*p->docs));
+        if (!p->keys || !p->docs)                               // if realloc fails
+            exit(-1);
+    }
+    p->keys[p->len] = key;
+    p->docs[p->len++] = doc;
+}
+
+/* Links the entries into buckets; at least as many buckets as entries.
+Entries are linked in reverse order, so that every chain is in order of documents. */
+void linkPostings(Postings *p) {
+    for (p->bits = 1; ((size_t)1 << p->bits) < p->len; p->bits++)
+        ;
+    p->head = malloc(((size_t)1 << p->bits) * sizeof(*p->head));
+    p->next = malloc((p->len ? p->len : 1) * sizeof(*p->next));
+    if (!p->head || !p->next)                                   // if malloc fails
+        exit(-1);
+    memset(p->head, -1, ((size_t)1 << p->bits) * sizeof(*p->head));
+    for (size_t e = p->len; e-- > 0; ) {
+        size_t b = (size_t)((p->keys[e] * GOLDEN) >> (64 - p->bits));
+        p->next[e] = p->head[b];
+        p->head[b] = (long)e;
+    }
+}
+
+void freePostings(Postings *p) {
+    free(p->head);
+    free(p->next);
+    free(p->keys);
+    free(p->docs);
+}
+
+/* Set of candidate pairs (a << 32 | b, with a < b), with the number of keys that they share.
+Open addressing with linear probing; a slot holds 1 + the index of the pair in list, or 0 if it's empty. */
+typedef struct PairSet PairSet;
+
+struct PairSet {
+    size_t *slots;
+    int bits;                                                   // number of slots == 2**bits
+    ull *list;                                                  // pairs in insertion order
+    uint *counts;                                               // numbers of shared keys, in the same order
+    size_t len;
+};
+
+void growPairs(PairSet *s) {
+    s->bits = s->bits ? s->bits + 1 : 10;
+    free(s->slots);
+    s->slots = calloc((size_t)1 << s->bits, sizeof(*s->slots));
+    s->list = realloc(s->list, ((size_t)1 << s->bits) / 2 * sizeof(*s->list));
+    s->counts = realloc(s->counts, ((size_t)1 << s->bits) / 2 * sizeof(*s->counts));
+    if (!s->slots || !s->list || !s->counts)                    // if malloc or realloc fails
+        exit(-1);
+    size_t mask = ((size_t)1 << s->bits) - 1;
+    for (size_t e = 0; e < s->len; e++) {
+        size_t i = (size_t)((s->list[e] * GOLDEN) >> (64 - s->bits));
+        while (s->slots[i])
+            i = (i + 1) & mask;
+        s->slots[i] = e + 1;
+    }
+}
+
+/* Load factor is kept at most 1/2. */
+void addPair(PairSet *s, uint a, uint b) {
+    ull key = (ull)a << 32 | b;
+    size_t mask = ((size_t)1 << s->bits) - 1;
+    size_t i = (size_t)((key * GOLDEN) >> (64 - s->bits));
+    for ( ; s->slots[i]; i = (i + 1) & mask) {
+        if (s->list[s->slots[i] - 1] == key) {
+            s->counts[s->slots[i] - 1]++;
+            return;
+        }
+    }
+    if (2 * (s->len + 1) > ((size_t)1 << s->bits)) {
+        growPairs(s);
+        addPair(s, a, b);
+        return;
+    }
+    s->slots[i] = s->len + 1;
+    s->list[s->len] = key;
+    s->counts[s->len++] = 1;
+}
+
+/* Number of keys that the pair shares, or 0 if it isn't in the set. */
+uint lookupCount(const PairSet *s, ull key) {
+    size_t mask = ((size_t)1 << s->bits) - 1;
+    for (size_t i = (size_t)((key * GOLDEN) >> (64 - s->bits)); s->slots[i]; i = (i + 1) & mask) {
+        if (s->list[s->slots[i] - 1] == key)
+            return s->counts[s->slots[i] - 1];
+    }
+    return 0;
+}
+
+/* Every pair of documents that have an equal key becomes a candidate. If the key has more than maxPosting documents,
+they are paired only with the first one, and the pairs of the others don't count that key, so it's counted
+in unpaired[] of each of the others instead: the pair (a, b) shares at most min(unpaired[a], unpaired[b])
+keys that it doesn't count. Equal keys are in the same chain; an entry that has been grouped already is marked in done.
+Returns the number of keys with more than maxPosting documents. */
+size_t collectCandidates(const Postings *p, size_t maxPosting, PairSet *pairs, uint *unpaired) {
+    size_t numLarge = 0;
+    unsigned char *done = calloc(p->len ? p->len : 1, 1);
+    long *group = malloc((p->len ? p->len : 1) * sizeof(*group));
+    if (!done || !group)                                        // if malloc fails
+        exit(-1);
+    for (size_t b = 0; b < ((size_t)1 << p->bits); b++) {
+        for (long e = p->head[b]; e != -1; e = p->next[e]) {
+            if (done[e])
+                continue;
+            size_t n = 0;
+            for (long f = e; f != -1; f = p->next[f]) {
+                if (p->keys[f] == p->keys[e]) {
+                    group[n++] = f;
+                    done[f] = 1;
+                }
+            }
+            if (n > maxPosting) {
+                numLarge++;
+                for (size_t i = 1; i < n; i++) {
+                    addPair(pairs, p->docs[group[0]], p->docs[group[i]]);
+                    unpaired[p->docs[group[i]]]++;
+                }
+                continue;
+            }
+            for (size_t i = 0; i < n; i++)
+                for (size_t j = i + 1; j < n; j++)
+                    addPair(pairs, p->docs[group[i]], p->docs[group[j]]);
+        }
+    }
+    free(done);
+    free(group);
+    return numLarge;
+}
+
+/* Fraction of equal values of two MinHash signatures. */
+double signatureSimilarity(const uint *a, const uint *b) {
+    int equal = 0;
+    for (int j = 0; j < NUM_HASHES; j++)
+        equal += a[j] == b[j];
+    return (double)equal / NUM_HASHES;
+}
+
+/* Jaccard similarity of two sorted sets of fingerprints. */
+double jaccard(const ull *a, size_t na, const ull *b, size_t nb) {
+    size_t i = 0, j = 0, common = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j])
+            i++;
+        else if (a[i] > b[j])
+            j++;
+        else {
+            common++;
+            i++;
+            j++;
+        }
+    }
+    return (double)common / (double)(na + nb - common);
+}
+
+/* Indexes the fingerprints of all documents, and prints the candidate pairs whose similarity is at least threshold,
+in order of documents. Returns the number of candidates, and puts the number of keys with more than MAX_POSTING
+documents in numLarge. */
+size_t findNearDuplicates(Corpus *c, double threshold, size_t *numLarge) {
+    Postings p = { 0, NULL, NULL, NULL, NULL, 0, 0 };
+    for (size_t i = 0; i < c->numDocs; i++) {
+        const Document *d = &c->docs[i];
+        if (!c->w && d->sig) {
+            for (int band = 0; band < BANDS; band++) {
+                ull key = mix64((ull)band + 1);
+                for (int r = 0; r < ROWS; r++)
+                    key = mix64(key ^ d->sig[band * ROWS + r]);
+                addEntry(&p, key, (uint)i);
+            }
+        }
+        for (size_t j = 0; j < d->numPrints; j++)
+            addEntry(&p, d->prints[j], (uint)i);
+    }
+    linkPostings(&p);
+
+    PairSet pairs = { NULL, 0, NULL, NULL, 0 };
+    growPairs(&pairs);
+    uint *unpaired = calloc(c->numDocs ? c->numDocs : 1, sizeof(*unpaired));
+    if (!unpaired)                                              // if malloc fails
+        exit(-1);
+    *numLarge = collectCandidates(&p, MAX_POSTING, &pairs, unpaired);
+    freePostings(&p);
+
+    /* Pairs are verified in order of documents; a sorted copy is made, since list is the order of slots. */
+    ull *sorted = malloc((pairs.len ? pairs.len : 1) * sizeof(*sorted));
+    if (!sorted)                                                // if malloc fails
+        exit(-1);
+    for (size_t e = 0; e < pairs.len; e++)
+        sorted[e] = pairs.list[e];
+    qsort(sorted, pairs.len, sizeof(*sorted), compareULL);
+    for (size_t e = 0; e < pairs.len; e++) {
+        const Document *a = &c->docs[sorted[e] >> 32], *b = &c->docs[sorted[e] & 0xffffffffu];
+        double s;
+        if (c->w) {
+            /* Jaccard similarity t needs at least t*(na + nb)/(1 + t) common fingerprints, and the shared keys
+            are (at most) those, so pairs that share too few are dropped without merging their sets.
+            Keys of large lists where neither of the two is the first file aren't counted, so they are added. */
+            uint ua = unpaired[sorted[e] >> 32], ub = unpaired[sorted[e] & 0xffffffffu];
+            uint shared = lookupCount(&pairs, sorted[e]) + (ua < ub ? ua : ub);
+            if (shared < threshold * (double)(a->numPrints + b->numPrints) / (1 + threshold))
+                continue;
+            s = jaccard(a->prints, a->numPrints, b->prints, b->numPrints);
+        }
+        else
+            s = signatureSimilarity(a->sig, b->sig);
+        if (s >= threshold)
+            printf("%.3f %s %s\n", s, a->path, b->path);
+    }
+    free(sorted);
+    free(unpaired);
+    size_t numCandidates = pairs.len;
+    free(pairs.slots);
+    free(pairs.list);
+    free(pairs.counts);
+    return numCandidates;
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* Usage: near_duplicates [-k K] [-w W] [-t THRESHOLD] [-j THREADS] DIR
+Without -w, MinHash is used. Statistics go to stderr. */
+int main(int argc, char *argv[]) {
+    Corpus c;
+    memset(&c, 0, sizeof(c));
+    c.k = K;
+    double threshold = THRESHOLD;
+    int numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int a = 1;
+    for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2) {
+        if (!strcmp(argv[a], "-k"))
+            c.k = atoi(argv[a + 1]);
+        else if (!strcmp(argv[a], "-w"))
+            c.w = atoi(argv[a + 1]);
+        else if (!strcmp(argv[a], "-t"))
+            threshold = atof(argv[a + 1]);
+        else if (!strcmp(argv[a], "-j"))
+            numThreads = atoi(argv[a + 1]);
+    }
+    if (a >= argc || c.k < 1 || c.w < 0 || c.w > MAX_WINNOW) {
+        fprintf(stderr, "Usage: near_duplicates [-k K] [-w W (at most %d)] [-t THRESHOLD] [-j THREADS] DIR\n", MAX_WINNOW);
+        return 1;
+    }
+    numThreads = numThreads < 1 ? 1 : numThreads > MAX_THREADS ? MAX_THREADS : numThreads;
+
+    c.x = randomBase();
+    c.y = 1;
+    for (int i = 0; i < c.k; i++)
+        c.y = mulMod(c.y, c.x);
+
+    double t0 = now();
+    collectFiles(&c, argv[a]);
+    qsort(c.docs, c.numDocs, sizeof(*c.docs), compareDocuments);
+    double t1 = now();
+    fingerprintAll(&c, numThreads);
+    double t2 = now();
+    size_t numLarge;
+    size_t numCandidates = findNearDuplicates(&c, threshold, &numLarge);
+    double t3 = now();
+    fprintf(stderr, "%zu files: listing %.3f s, fingerprinting %.3f s (%d threads), %zu candidate pairs %.3f s"
+            " (%zu keys of more than %d files)\n",
+            c.numDocs, t1 - t0, t2 - t1, numThreads, numCandidates, t3 - t2, numLarge, MAX_POSTING);
+
+    for (size_t i = 0; i < c.numDocs; i++) {
+        free(c.docs[i].path);
+        free(c.docs[i].sig);
+        free(c.docs[i].prints);
+    }
+    free(c.docs);
+    return 0;
+}
+
+/* Test data:
+
+Output has one row per pair of similar files: their similarity, and their paths.
+Similarities vary a bit from run to run, since the base x is random.
+
+Input (a directory with a text of 400 words, a copy of it with every 25th word replaced, and an unrelated text):
+near_duplicates docs
+Output:
+0.789 docs/a.txt docs/a_edited.txt
+
+Input (the same, with winnowing):
+near_duplicates -w 16 docs
+Output:
+0.796 docs/a.txt docs/a_edited.txt
+Statistics (stderr):
+3 files: listing 0.000 s, fingerprinting 0.000 s (1 threads), 3 candidate pairs 0.000 s (0 keys of more than 64 files)
+
+Input (70 copies of the text, named copy00.txt to copy69.txt, the edited text, named a_edited.txt,
+and the unrelated text; more than MAX_POSTING files share every band):
+near_duplicates docs70
+Output (139 rows: the edited text with every copy, and the first copy with every other one):
+0.867 docs70/a_edited.txt docs70/copy00.txt
+0.867 docs70/a_edited.txt docs70/copy01.txt
+...
+0.867 docs70/a_edited.txt docs70/copy69.txt
+1.000 docs70/copy00.txt docs70/copy01.txt
+...
+1.000 docs70/copy00.txt docs70/copy69.txt
+Statistics (stderr):
+72 files: listing 0.000 s, fingerprinting 0.001 s (1 threads), 139 candidate pairs 0.000 s (32 keys of more than 64 files)
+With -w 16, the output has the same 139 pairs.
+*/
+
+#endif // NEAR_DUPLICATES
@@ -0,0 +1,431 @@
+//#define HASH_GREP
+#ifdef HASH_GREP
+
+/* Find pattern in all files of a directory tree */
+
+/* Like "grep -rbo", for a fixed pattern: every regular file under the given paths is searched with Rabin-Karp,
+and every occurence is printed as a row "file:offset", where offset is in bytes, from the beginning of the file.
+
+Files are mapped into memory with mmap(), instead of read into a buffer, so there is no copying,
+and only the pages that are searched are ever read. Every task maps only its own range of a file.
+
+Work is distributed over a work-stealing pool of threads. Every thread has its own deque of tasks;
+it takes tasks from the bottom of its own deque, and when that's empty, it steals from the top of the deque
+of another thread. At the start, every task is a whole file, and files are dealt to the deques in turns.
+A thread that takes a task larger than CHUNK_SIZE splits it: it keeps the first CHUNK_SIZE bytes,
+and pushes the rest back to its deque, where an idle thread can steal it (and split it further).
+So a single large file is searched by all threads, and many small files cost one task each.
+As in "hash_substring_parallel.c", a chunk is extended by lenP - 1 bytes into the next one,
+so every window belongs to exactly one chunk, and no occurence is lost at a chunk boundary.
+
+Every thread formats its rows into its own buffer, and writes it out after every task, under a lock,
+so the rows of a task are together, and in order; but tasks finish in any order, so rows are in no particular order
+across tasks (sort them if needed).
+
+Uses POSIX threads, mmap() and dirent (link with -pthread). */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAX_THREADS 256
+#define CHUNK_SIZE (1u << 23)                                   // Tasks larger than this many bytes (8 MiB) are split.
+#define OUT_BUF_SIZE (1u << 16)                                 // A thread writes its rows out when its buffer gets this full, or after a task.
+#define X 0x01000193u                                           // Multiplier; odd, so that it's invertible modulo 2**32.
+
+typedef unsigned long long ull;
+typedef unsigned int uint;
+
+/* FILE LIST CODE */
+
+typedef struct FileList FileList;
+
+struct FileList {
+    char **paths;
+    size_t *sizes;
+    size_t len, cap;
+};
+
+void addFile(FileList *files, const char *path, size_t size) {
+    if (files->len == files->cap) {
+        files->cap = files->cap ? files->cap << 1 : 64;
+        files->paths = realloc(files->paths, files->cap * sizeof(*files->paths));
+        files->sizes = realloc(files->sizes, files->cap * sizeof(*files->sizes));
+        if (!files->paths || !files->sizes)                     // if realloc fails
+            exit(-1);
+    }
+    files->paths[files->len] = malloc(strlen(path) + 1);
+    if (!files->paths[files->len])                              // if malloc fails
+        exit(-1);
+    strcpy(files->paths[files->len], path);
+    files->sizes[files->len++] = size;
+}
+
+/* Adds path, if it's a regular file, or all regular files under it, if it's a directory. Symbolic links aren't followed. */
+void collectFiles(FileList *files, const char *path) {
+    struct stat st;
+    if (lstat(path, &st)) {
+        perror(path);
+        return;
+    }
+    if (S_ISREG(st.st_mode)) {
+        addFile(files, path, (size_t)st.st_size);
+        return;
+    }
+    if (!S_ISDIR(st.st_mode))
+        return;
+
+    DIR *d = opendir(path);
+    if (!d) {
+        perror(path);
+        return;
+    }
+    struct dirent *e;
+    size_t lenPath = strlen(path);
+    char *child = malloc(lenPath + 258);
+    if (!child)                                                 // if malloc fails
+        exit(-1);
+    while ((e = readdir(d))) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, ".."))
+            continue;
+        sprintf(child, "%s/%.255s", path, e->d_name);
+        collectFiles(files, child);
+    }
+    free(child);
+    closedir(d);
+}
+
+
+/* WORK-STEALING CODE */
+
+/* Windows that start in [begin, end) of a file. */
+typedef struct Task Task;
+
+struct Task {
+    size_t file;
+    size_t begin, end;
+};
+
+/* A growable ring of tasks. The owner pushes and pops at the bottom, thieves steal from the top.
+Every deque has its own lock, so threads contend only when one steals from another. */
+typedef struct Deque Deque;
+
+struct Deque {
+    Task *tasks;
+    size_t top, len, cap;                                       // tasks[top % cap] is the oldest one; cap is a power of two
+    pthread_mutex_t lock;
+};
+
+void pushBottom(Deque *d, Task t) {
+    pthread_mutex_lock(&d->lock);
+    if (d->len == d->cap) {
+        size_t cap = d->cap ? d->cap << 1 : 64;
+        Task *tasks = malloc(cap * sizeof(*tasks));
+        if (!tasks)                                             // if malloc fails
+            exit(-1);
+        for (size_t i = 0; i < d->len; i++)
+            tasks[i] = d->tasks[(d->top + i) & (d->cap - 1)];
+        free(d->tasks);
+        d->tasks = tasks;
+        d->top = 0;
+        d->cap = cap;
+    }
+    d->tasks[(d->top + d->len++) & (d->cap - 1)] = t;
+    pthread_mutex_unlock(&d->lock);
+}
+
+int popBottom(Deque *d, Task *t) {
+    int found = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->len) {
+        *t = d->tasks[(d->top + --d->len) & (d->cap - 1)];
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+int stealTop(Deque *d, Task *t) {
+    int found = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->len) {
+        *t = d->tasks[d->top++ & (d->cap - 1)];
+        d->len--;
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+
+/* SEARCH CODE */
+
+typedef struct Pool Pool;
+
+struct Pool {
+    const FileList *files;
+    const unsigned char *P;
+    size_t lenP;
+    uint pHash, xPower;                                         // hash of P, and X**lenP
+    int numThreads;
+    Deque deques[MAX_THREADS];
+    size_t pending;                                             // tasks that were pushed, and aren't finished yet
+    pthread_mutex_t pendingLock;
+    pthread_mutex_t outLock;
+    size_t pageSize;
+    ull numMatches;
+};
+
+typedef struct Worker Worker;
+
+struct Worker {
+    Pool *pool;
+    int id;
+    char *out;                                                  // rows that aren't written yet
+    size_t outLen;
+    ull numMatches;
+};
+
+void addPending(Pool *pool, long delta) {
+    pthread_mutex_lock(&pool->pendingLock);
+    pool->pending += delta;
+    pthread_mutex_unlock(&pool->pendingLock);
+}
+
+size_t getPending(Pool *pool) {
+    pthread_mutex_lock(&pool->pendingLock);
+    size_t pending = pool->pending;
+    pthread_mutex_unlock(&pool->pendingLock);
+    return pending;
+}
+
+void flushRows(Worker *w) {
+    if (!w->outLen)
+        return;
+    pthread_mutex_lock(&w->pool->outLock);
+    fwrite(w->out, 1, w->outLen, stdout);
+    pthread_mutex_unlock(&w->pool->outLock);
+    w->outLen = 0;
+}
+
+/* Appends the row "path:offset". */
+void addRow(Worker *w, const char *path, ull offset) {
+    size_t lenPath = strlen(path);
+    if (w->outLen + lenPath + 22 > OUT_BUF_SIZE)
+        flushRows(w);
+    memcpy(w->out + w->outLen, path, lenPath);
+    w->outLen += lenPath;
+    w->outLen += sprintf(w->out + w->outLen, ":%llu\n", offset);
+    w->numMatches++;
+}
+
+/* Searches windows of a file that start in [t->begin, t->end), with Rabin-Karp, in the file mapped into memory. */
+void searchTask(Worker *w, const Task *t) {
+    Pool *pool = w->pool;
+    const char *path = pool->files->paths[t->file];
+    size_t lenP = pool->lenP;
+    size_t last = t->end + lenP - 1;                            // the end of the last window
+    if (last > pool->files->sizes[t->file])
+        return;                                                 // the file has shrunk since it was listed, or it's shorter than P
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return;
+    }
+    size_t mapBegin = t->begin & ~(pool->pageSize - 1);         // mmap() offsets must be multiples of the page size
+    size_t mapLen = last - mapBegin;
+    void *map = mmap(NULL, mapLen, PROT_READ, MAP_PRIVATE, fd, (off_t)mapBegin);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return;
+    }
+    madvise(map, mapLen, MADV_SEQUENTIAL);
+
+    const unsigned char *T = (const unsigned char *)map - mapBegin;        // T[i] is the byte at offset i of the file
+    const unsigned char *P = pool->P;
+    uint h = 0;
+    for (size_t i = t->begin; i < t->begin + lenP; i++)
+        h = h * X + T[i];
+    for (size_t i = t->begin; ; i++) {
+        if (h == pool->pHash && !memcmp(T + i, P, lenP))
+            addRow(w, path, i);
+        if (i + 1 == t->end)
+            break;
+        h = h * X + T[i + lenP] - pool->xPower * T[i];
+    }
+
+    munmap(map, mapLen);
+}
+
+/* Takes a task from its own deque, or steals one. Returns 0 when all tasks are finished. */
+int getTask(Worker *w, Task *t) {
+    Pool *pool = w->pool;
+    for (;;) {
+        if (popBottom(&pool->deques[w->id], t))
+            return 1;
+        for (int k = 1; k < pool->numThreads; k++) {
+            if (stealTop(&pool->deques[(w->id + k) % pool->numThreads], t))
+                return 1;
+        }
+        /* Nothing to take; but tasks that are still running may push more. */
+        if (!getPending(pool))
+            return 0;
+        sched_yield();
+    }
+}
+
+void *searchWorker(void *arg) {
+    Worker *w = arg;
+    Pool *pool = w->pool;
+    Task t;
+    while (getTask(w, &t)) {
+        if (t.end - t.begin > CHUNK_SIZE) {
+            Task rest = { t.file, t.begin + CHUNK_SIZE, t.end };
+            addPending(pool, 1);
+            pushBottom(&pool->deques[w->id], rest);
+            t.end = t.begin + CHUNK_SIZE;
+        }
+        searchTask(w, &t);
+        flushRows(w);
+        addPending(pool, -1);
+    }
+    return NULL;
+}
+
+/* Prints "file:offset" rows for all occurences of P in all files, with numThreads threads. Returns the number of occurences. */
+ull grepFiles(const FileList *files, const char *P, size_t lenP, int numThreads) {
+    Pool *pool = calloc(1, sizeof(*pool));
+    Worker workers[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    if (!pool)                                                  // if calloc fails
+        exit(-1);
+
+    pool->files = files;
+    pool->P = (const unsigned char *)P;
+    pool->lenP = lenP;
+    pool->xPower = 1;
+    for (size_t i = 0; i < lenP; i++) {
+        pool->pHash = pool->pHash * X + pool->P[i];
+        pool->xPower *= X;
+    }
+    pool->numThreads = numThreads;
+    pool->pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    pthread_mutex_init(&pool->pendingLock, NULL);
+    pthread_mutex_init(&pool->outLock, NULL);
+    for (int t = 0; t < numThreads; t++)
+        pthread_mutex_init(&pool->deques[t].lock, NULL);
+
+    /* Files are dealt to the deques in turns. */
+    for (size_t f = 0, t = 0; f < files->len; f++) {
+        if (files->sizes[f] < lenP)
+            continue;
+        Task task = { f, 0, files->sizes[f] - lenP + 1 };
+        pushBottom(&pool->deques[t], task);
+        pool->pending++;
+        t = (t + 1) % numThreads;
+    }
+
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].pool = pool;
+        workers[t].id = t;
+        workers[t].out = malloc(OUT_BUF_SIZE);
+        workers[t].outLen = 0;
+        workers[t].numMatches = 0;
+        if (!workers[t].out)                                    // if malloc fails
+            exit(-1);
+    }
+    for (int t = 1; t < numThreads; t++) {
+        if (pthread_create(&threads[t], NULL, searchWorker, &workers[t]))
+            exit(-1);
+    }
+    searchWorker(&workers[0]);
+    for (int t = 1; t < numThreads; t++)
+        pthread_join(threads[t], NULL);
+
+    ull numMatches = 0;
+    for (int t = 0; t < numThreads; t++) {
+        numMatches += workers[t].numMatches;
+        free(workers[t].out);
+        free(pool->deques[t].tasks);
+        pthread_mutex_destroy(&pool->deques[t].lock);
+    }
+    pthread_mutex_destroy(&pool->pendingLock);
+    pthread_mutex_destroy(&pool->outLock);
+    free(pool);
+    return numMatches;
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* Usage: hash_grep [-j THREADS] PATTERN PATH...
+PATHs are files or directories. Statistics go to stderr. */
+int main(int argc, char *argv[]) {
+    int numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int a = 1;
+    if (a + 1 < argc && !strcmp(argv[a], "-j")) {
+        numThreads = atoi(argv[a + 1]);
+        a += 2;
+    }
+    if (a + 1 >= argc || !*argv[a]) {
+        fprintf(stderr, "Usage: hash_grep [-j THREADS] PATTERN PATH...\n");
+        return 1;
+    }
+    numThreads = numThreads < 1 ? 1 : numThreads > MAX_THREADS ? MAX_THREADS : numThreads;
+
+    FileList files = { NULL, NULL, 0, 0 };
+    double t0 = now();
+    for (int i = a + 1; i < argc; i++)
+        collectFiles(&files, argv[i]);
+    double t1 = now();
+
+    ull numBytes = 0;
+    for (size_t f = 0; f < files.len; f++)
+        numBytes += files.sizes[f];
+    ull numMatches = grepFiles(&files, argv[a], strlen(argv[a]), numThreads);
+    double t2 = now();
+    fprintf(stderr, "%zu files, %llu bytes, %llu matches: listing %.3f s, searching %.3f s (%d threads)\n",
+            files.len, numBytes, numMatches, t1 - t0, t2 - t1, numThreads);
+
+    for (size_t f = 0; f < files.len; f++)
+        free(files.paths[f]);
+    free(files.paths);
+    free(files.sizes);
+    return 0;
+}
+
+/* Test data:
+
+Output has one row per occurence: the path of the file, and the offset of the occurence in it.
+
+Input (a directory with a.txt containing "abacaba", and sub/b.txt containing "xaba"):
+hash_grep aba dir
+Output (in any order):
+dir/a.txt:0
+dir/a.txt:4
+dir/sub/b.txt:1
+Statistics (stderr):
+2 files, 11 bytes, 3 matches: listing 0.000 s, searching 0.000 s (1 threads)
+*/
+
+#endif // HASH_GREP
@@ -0,0 +1,410 @@
+//#define HASH_INDEX
+#ifdef HASH_INDEX
+
+/* Prefix-hash index of a text */
+
+/* The index is built once per text, and it holds prefix hashes and powers of the base x:
+    prefix[0] = 0, prefix[i + 1] = prefix[i]*x + T[i]
+    powers[k] = x**k
+Then the hash of any substring is available in O(1), without rehashing T:
+    hash(T[i..i+k)) = prefix[i + k] - prefix[i]*powers[k]
+and that answers many queries on the same text:
+    - are T[i..i+k) and T[j..j+k) equal: O(1),
+    - longest common prefix of the suffixes at i and j: O(log n), by binary search on the length,
+    - occurences of a pattern: O(log n * log m + occ), without a pass over the text, with a suffix array.
+The suffix array (starts of all suffixes of T, in lexicographic order) is built on the first pattern query,
+by prefix doubling: suffixes sorted by their first k characters have ranks, and the ranks of the first and
+of the second half of a 2k-character prefix sort them by 2k characters, with two passes of counting sort.
+That's O(n) per round, without comparisons, and the rounds stop once all ranks differ, so there are about
+log2 of the longest repeated substring of them, and at most log2 n: O(n log n) in all.
+So the build is the cost of the first query: about 0.5 s for 2 MB of text made of words, where a single
+Rabin-Karp scan takes milliseconds, and the index pays off after some hundreds of queries.
+A text that is a long repeat of itself takes more rounds (6 s for two copies of those 2 MB).
+The suffixes that start with P are a contiguous range of the suffix array, which is found by two binary searches,
+and comparing P to a suffix is an LCP, by binary search on prefix hashes of P.
+The index takes 16 bytes per byte of T, and the suffix array 8 more (and 16 more while it's being built).
+
+The arithmetic is the same as in "hash_substring_alt.c": modulo the Mersenne prime 2**61 - 1,
+with a random base x, a 128-bit multiply and bit-twiddling reduction.
+Equality and LCP answers, and the binary searches for P, are based on hashes alone, so they are wrong
+with probability at most n / 2**61 per probe, which is practically never. Pattern occurences are verified. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <intrin.h>                                             // _umul128()
+#endif // _MSC_VER
+
+#define MAX_NUM_ITEMS 500001                                    // Max length of T when it's read from stdin, and of P. +1 for '\0'.
+#define PRIME 2305843009213693951llu                            // 2**61 - 1
+#define POWER 61                                                // PRIME == 2**POWER - 1
+#define M 0x1fffffffffffffffllu
+#define Q 61
+#define R 0x1fffffffffffffffllu
+
+typedef unsigned long long ull;
+
+/* HASH CODE */
+
+/* h % PRIME, for h < 2**(2*POWER).
+http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivision */
+ull reduce(ull h) {
+    /* h % PRIME goes into m (modulus) */
+    ull m;
+
+    m = (h & M) + ((h >> POWER) & M);
+
+    for ( ; m > PRIME; )
+        m = (m >> Q) + (m & R);
+
+    return m == PRIME ? 0 : m;
+}
+
+/* a * b % PRIME, for a, b < PRIME. */
+ull mulMod(ull a, ull b) {
+#ifdef _MSC_VER
+    ull hi, lo = _umul128(a, b, &hi);
+    return reduce((lo & M) + ((lo >> POWER) | (hi << (64 - POWER))));
+#else
+    unsigned __int128 p = (unsigned __int128)a * b;
+    return reduce(((ull)p & M) + (ull)(p >> POWER));
+#endif // _MSC_VER
+}
+
+/* A random base in [2, PRIME - 1], from splitmix64 (http://xorshift.di.unimi.it/splitmix64.c). */
+ull randomBase(void) {
+    static ull state = 0;
+    if (!state)
+        state = (ull)time(NULL) ^ ((ull)clock() << 32) ^ (ull)(size_t)&state;
+
+    ull z = (state += 0x9e3779b97f4a7c15llu);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9llu;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebllu;
+    z = z ^ (z >> 31);
+
+    return 2 + z % (PRIME - 2);
+}
+
+
+/* INDEX CODE */
+
+typedef struct TextIndex TextIndex;
+
+struct TextIndex {
+    const unsigned char *T;                                     // not owned
+    size_t lenT;
+    ull x;                                                      // base
+    ull *prefix;                                                // lenT + 1 prefix hashes
+    ull *powers;                                                // powers[k] == x**k % PRIME, for k in [0, lenT]
+    size_t *sa;                                                 // suffix array; NULL until the first pattern query
+};
+
+/* Builds the index in O(n). T must outlive it. */
+TextIndex *buildIndex(const char *T, size_t lenT) {
+    TextIndex *ix = malloc(sizeof(*ix));
+    if (!ix)                                                    // if malloc fails
+        exit(-1);
+    ix->T = (const unsigned char *)T;
+    ix->lenT = lenT;
+    ix->x = randomBase();
+    ix->sa = NULL;
+    ix->prefix = malloc((lenT + 1) * sizeof(*ix->prefix));
+    ix->powers = malloc((lenT + 1) * sizeof(*ix->powers));
+    if (!ix->prefix || !ix->powers)
+        exit(-1);
+
+    ix->prefix[0] = 0;
+    ix->powers[0] = 1;
+    for (size_t i = 0; i < lenT; i++) {
+        ix->prefix[i + 1] = reduce(mulMod(ix->prefix[i], ix->x) + ix->T[i]);
+        ix->powers[i + 1] = mulMod(ix->powers[i], ix->x);
+    }
+    return ix;
+}
+
+void freeIndex(TextIndex *ix) {
+    free(ix->prefix);
+    free(ix->powers);
+    free(ix->sa);
+    free(ix);
+}
+
+/* Hash of T[i..i+k), in O(1). i + k must be at most lenT. */
+ull substringHash(const TextIndex *ix, size_t i, size_t k) {
+    return reduce(ix->prefix[i + k] + PRIME - mulMod(ix->prefix[i], ix->powers[k]));
+}
+
+/* Hash of the first n characters of s, with the base of the index, so that it can be compared to substringHash(). */
+ull patternHash(const TextIndex *ix, const char *s, size_t n) {
+    const unsigned char *u = (const unsigned char *)s;
+    ull h = 0;
+
+    for (size_t i = 0; i < n; i++)
+        h = reduce(mulMod(h, ix->x) + u[i]);
+
+    return h;
+}
+
+/* Are T[i..i+k) and T[j..j+k) equal? O(1).
+Substrings that don't fit into T are never equal. */
+int substringsEqual(const TextIndex *ix, size_t i, size_t j, size_t k) {
+    if (i + k > ix->lenT || j + k > ix->lenT)
+        return 0;
+    return substringHash(ix, i, k) == substringHash(ix, j, k);
+}
+
+/* Length of the longest common prefix of the suffixes at i and j. O(log n).
+Binary search on the length: equality of prefixes is monotone in their length. */
+size_t lcp(const TextIndex *ix, size_t i, size_t j) {
+    if (i >= ix->lenT || j >= ix->lenT)
+        return 0;
+    if (i == j)
+        return ix->lenT - i;
+
+    size_t lo = 0;                                              // the prefixes of length lo are equal
+    size_t hi = ix->lenT - (i > j ? i : j);                     // and the ones of length greater than hi can't be
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (substringHash(ix, i, mid) == substringHash(ix, j, mid))
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+
+/* SUFFIX ARRAY CODE */
+
+/* Builds the suffix array of the index by prefix doubling, in O(n log n).
+rank[i] is the rank of the first k characters of the suffix at i, among distinct prefixes of that length,
+so the ranks are all different, and the array is sorted, when the largest one is n - 1. */
+void buildSuffixArray(TextIndex *ix) {
+    size_t n = ix->lenT;
+    size_t *sa = malloc((n ? n : 1) * sizeof(*sa));
+    size_t *rank = malloc((n ? n : 1) * sizeof(*rank));
+    size_t *tmp = malloc((n ? n : 1) * sizeof(*tmp));
+    size_t *count = malloc(((n > 256 ? n : 256) + 1) * sizeof(*count));
+    if (!sa || !rank || !tmp || !count)                         // if malloc fails
+        exit(-1);
+
+    /* k == 1: counting sort by the first character. */
+    memset(count, 0, 257 * sizeof(*count));
+    for (size_t i = 0; i < n; i++)
+        count[ix->T[i] + 1]++;
+    for (size_t c = 1; c <= 256; c++)
+        count[c] += count[c - 1];
+    for (size_t i = 0; i < n; i++)
+        sa[count[ix->T[i]]++] = i;
+    for (size_t r = 0; r < n; r++)
+        rank[sa[r]] = r ? rank[sa[r - 1]] + (ix->T[sa[r]] != ix->T[sa[r - 1]]) : 0;
+
+    for (size_t k = 1; n && rank[sa[n - 1]] != n - 1; k <<= 1) {
+        /* Order by the second half: suffixes that have no second half come first, and the others
+        follow in the order of their second halves, which are sorted already. */
+        size_t m = 0;
+        for (size_t i = n - k; i < n; i++)                      // k < n, since T has a repeat of length k
+            tmp[m++] = i;
+        for (size_t r = 0; r < n; r++)
+            if (sa[r] >= k)
+                tmp[m++] = sa[r] - k;
+
+        /* Stable counting sort by the first half; ranks are less than n. */
+        memset(count, 0, (n + 1) * sizeof(*count));
+        for (size_t i = 0; i < n; i++)
+            count[rank[i] + 1]++;
+        for (size_t c = 1; c <= n; c++)
+            count[c] += count[c - 1];
+        for (size_t r = 0; r < n; r++)
+            sa[count[rank[tmp[r]]]++] = tmp[r];
+
+        /* New ranks, of 2k characters: equal pairs of ranks get equal ranks. */
+        tmp[sa[0]] = 0;
+        for (size_t r = 1; r < n; r++) {
+            size_t i = sa[r], j = sa[r - 1];
+            int equal = rank[i] == rank[j] && i + k < n && j + k < n && rank[i + k] == rank[j + k];
+            tmp[i] = tmp[j] + !equal;
+        }
+        size_t *t = rank;
+        rank = tmp;
+        tmp = t;
+    }
+
+    ix->sa = sa;
+    free(rank);
+    free(tmp);
+    free(count);
+}
+
+/* Compares the suffix at i to P, whose prefix hashes are pPrefix[0..lenP], in O(log m).
+Returns 0 if P is a prefix of the suffix, and otherwise, less or more than 0, as the suffix is smaller or larger than P. */
+int comparePattern(const TextIndex *ix, size_t i, const unsigned char *P, const ull *pPrefix, size_t lenP) {
+    size_t lo = 0;                                              // the prefixes of length lo are equal
+    size_t hi = ix->lenT - i < lenP ? ix->lenT - i : lenP;      // and the ones of length greater than hi can't be
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (substringHash(ix, i, mid) == pPrefix[mid])
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    if (lo == lenP)
+        return 0;
+    if (i + lo == ix->lenT)
+        return -1;
+    return (int)ix->T[i + lo] - (int)P[lo];
+}
+
+int compareSizes(const void *a, const void *b) {
+    size_t u = *(const size_t *)a, v = *(const size_t *)b;
+    return (u > v) - (u < v);
+}
+
+/* Prints positions of all occurences of P in the indexed text, in one row, in increasing order.
+Costs O(lenP) for hashing P, and O(log n * log m) for two binary searches on the suffix array;
+the text isn't scanned. Occurences are verified with memcmp(). */
+void findPattern(TextIndex *ix, const char *P, size_t lenP) {
+    if (lenP && lenP <= ix->lenT) {
+        if (!ix->sa)
+            buildSuffixArray(ix);
+
+        const unsigned char *U = (const unsigned char *)P;
+        ull *pPrefix = malloc((lenP + 1) * sizeof(*pPrefix));
+        if (!pPrefix)                                           // if malloc fails
+            exit(-1);
+        pPrefix[0] = 0;
+        for (size_t i = 0; i < lenP; i++)
+            pPrefix[i + 1] = reduce(mulMod(pPrefix[i], ix->x) + U[i]);
+
+        /* first is the first suffix that isn't smaller than P, and last the first one that is larger. */
+        size_t lo = 0, hi = ix->lenT;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (comparePattern(ix, ix->sa[mid], U, pPrefix, lenP) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        size_t first = lo;
+        hi = ix->lenT;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (comparePattern(ix, ix->sa[mid], U, pPrefix, lenP) <= 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        size_t last = lo;
+
+        /* Suffix array order isn't text order. */
+        size_t numMatches = 0, *pos = malloc((last > first ? last - first : 1) * sizeof(*pos));
+        if (!pos)                                               // if malloc fails
+            exit(-1);
+        for (size_t r = first; r < last; r++)
+            if (!memcmp(ix->T + ix->sa[r], P, lenP))
+                pos[numMatches++] = ix->sa[r];
+        qsort(pos, numMatches, sizeof(*pos), compareSizes);
+        for (size_t r = 0; r < numMatches; r++)
+            printf("%zu ", pos[r]);
+        free(pos);
+        free(pPrefix);
+    }
+    printf("\n");
+}
+
+/* Reads the whole file into memory. */
+char *readFile(const char *name, size_t *len) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(*len + 1);
+    if (!buf || fread(buf, 1, *len, f) != *len)
+        exit(-1);
+    buf[*len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* The text is the first row of stdin, or the file given as the only argument.
+The rest of stdin holds the number of queries, followed by the queries themselves. */
+int main(int argc, char *argv[]) {
+    static char pattern[MAX_NUM_ITEMS];
+    char *text;
+    size_t lenT;
+
+    if (argc > 1)
+        text = readFile(argv[1], &lenT);
+    else {
+        text = malloc(MAX_NUM_ITEMS);
+        if (!text)
+            exit(-1);
+        scanf("%500000s", text);
+        lenT = strlen(text);
+    }
+
+    TextIndex *ix = buildIndex(text, lenT);
+
+    size_t numQueries, i, j, k;
+    char type[5];
+    scanf("%zu", &numQueries);
+    for (size_t q = 0; q < numQueries; q++) {
+        scanf("%4s", type);
+        if (!strcmp(type, "find")) {
+            scanf("%500000s", pattern);
+            findPattern(ix, pattern, strlen(pattern));
+        }
+        else if (!strcmp(type, "eq")) {
+            scanf("%zu %zu %zu", &i, &j, &k);
+            printf("%s\n", substringsEqual(ix, i, j, k) ? "yes" : "no");
+        }
+        else {                                                  // type == "lcp"
+            scanf("%zu %zu", &i, &j);
+            printf("%zu\n", lcp(ix, i, j));
+        }
+    }
+
+    freeIndex(ix);
+    free(text);
+    return 0;
+}
+
+/* Test data:
+
+The first row of input contains the text, and the second one the number of queries.
+Possible queries are:
+find P - positions of occurences of P in the text,
+eq i j k - are the substrings of length k at i and at j equal,
+lcp i j - length of the longest common prefix of the suffixes at i and at j.
+
+Input:
+abacabadabacaba
+6
+find aba
+find cab
+eq 0 8 7
+eq 0 4 4
+lcp 0 8
+lcp 1 5
+Output:
+0 4 8 12
+3 11
+yes
+no
+7
+2
+*/
+
+#endif // HASH_INDEX
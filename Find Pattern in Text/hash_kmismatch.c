@@ -0,0 +1,407 @@
+//#define HASH_KMISMATCH
+#ifdef HASH_KMISMATCH
+
+/* Find pattern in text, with at most k mismatches */
+
+/* Finds all positions i where T[i..i+m) differs from P in at most k characters (substitutions only; m == lenP).
+
+The naive way compares P with every window, character by character: O(n*m).
+Here, prefix hashes of T and of P are computed once, as in "hash_index.c", and then every alignment is checked
+with at most k + 1 longest-common-extension (LCE) queries: an LCE query returns the length of the longest
+common prefix of T[i + j..] and P[j..], so it jumps over a whole run of matching characters at once.
+After every mismatch, the next query starts one character after it, so an alignment costs
+O(k) queries instead of O(m) comparisons, and it's abandoned as soon as it has k + 1 mismatches.
+
+In practice, most words of 8 characters of an alignment contain a mismatch, and then it's cheaper to count
+the different bytes of the word at once (with a popcount of their high bits) than to ask an LCE query
+where the first mismatch is. So the alignment is scanned a word at a time, and only a word without mismatches
+starts an LCE query, which jumps over the run that it begins. Every word either adds a mismatch, or ends
+with a jump to the next mismatch, so it's still O(k) words and queries per alignment.
+
+An LCE query compares the first DIRECT_COMPARE characters directly, eight at a time, since most runs are short, and then gallops:
+it compares hashes of prefixes of lengths growing as powers of two, and finishes with a binary search,
+so it costs O(log L) for a run of length L. All together O(n*k*log m).
+
+Alignments are checked in blocks of BLOCK_SIZE, and prefix hashes are computed only for the text of the current block,
+and only when an LCE query of that block needs them: on text that doesn't look like the pattern, runs are short,
+hashes are rarely needed, and the search runs as fast as the naive one; on repetitive text, it's much faster than it.
+Memory is O(BLOCK_SIZE + m), so files of any size that fit into memory can be searched.
+
+The arithmetic is the same as in "hash_index.c": modulo the Mersenne prime 2**61 - 1, with a random base x.
+Like lcp() there, LCE answers are based on hashes alone, so they are wrong with probability
+at most m / 2**61 per probe, which is practically never. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <intrin.h>                                             // _umul128(), _BitScanForward64()
+#endif // _MSC_VER
+
+#define MAX_NUM_ITEMS 500001                                    // Max length of P and T when they are read from stdin. +1 for '\0'.
+#define DIRECT_COMPARE 64                                       // An LCE query compares this many characters directly, before it uses hashes; a multiple of 8
+#define BLOCK_SIZE (1u << 16)                                   // Number of alignments whose text shares prefix hashes
+#define PRIME 2305843009213693951llu                            // 2**61 - 1
+#define POWER 61                                                // PRIME == 2**POWER - 1
+#define M 0x1fffffffffffffffllu
+#define Q 61
+#define R 0x1fffffffffffffffllu
+
+typedef unsigned long long ull;
+
+/* HASH CODE */
+
+/* h % PRIME, for h < 2**(2*POWER).
+http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivision */
+ull reduce(ull h) {
+    /* h % PRIME goes into m (modulus) */
+    ull m;
+
+    m = (h & M) + ((h >> POWER) & M);
+
+    for ( ; m > PRIME; )
+        m = (m >> Q) + (m & R);
+
+    return m == PRIME ? 0 : m;
+}
+
+/* a * b % PRIME, for a, b < PRIME. */
+ull mulMod(ull a, ull b) {
+#ifdef _MSC_VER
+    ull hi, lo = _umul128(a, b, &hi);
+    return reduce((lo & M) + ((lo >> POWER) | (hi << (64 - POWER))));
+#else
+    unsigned __int128 p = (unsigned __int128)a * b;
+    return reduce(((ull)p & M) + (ull)(p >> POWER));
+#endif // _MSC_VER
+}
+
+/* A random base in [2, PRIME - 1], from splitmix64 (http://xorshift.di.unimi.it/splitmix64.c). */
+ull randomBase(void) {
+    ull z = (ull)time(NULL) ^ ((ull)clock() << 32) ^ (ull)(size_t)&z;
+    z += 0x9e3779b97f4a7c15llu;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9llu;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebllu;
+    z = z ^ (z >> 31);
+
+    return 2 + z % (PRIME - 2);
+}
+
+
+/* LCE CODE */
+
+/* Number of equal leading bytes of two different 8-byte words, which were loaded on a little-endian machine. */
+size_t equalBytes(ull u, ull v) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward64(&bit, u ^ v);
+    return bit / 8;
+#else
+    return (size_t)__builtin_ctzll(u ^ v) / 8;
+#endif // _MSC_VER
+}
+
+typedef struct Aligner Aligner;
+
+struct Aligner {
+    const unsigned char *T, *P;                                 // not owned
+    size_t lenT, lenP;
+    ull x;                                                      // base
+    size_t blockStart;                                          // first alignment of the current block
+    int blockHashed;                                            // are prefixT[] computed for the current block
+    ull *prefixT;                                               // prefix hashes of T[blockStart..blockStart + BLOCK_SIZE + lenP - 1)
+    ull *prefixP;                                               // lenP + 1 prefix hashes of P
+    ull *powers;                                                // powers[k] == x**k % PRIME, for k in [0, lenP]; no common extension is longer than P
+};
+
+/* Fills prefix[0..n] with prefix hashes of s: prefix[0] = 0, prefix[i + 1] = prefix[i]*x + s[i]. */
+void prefixHashes(ull *prefix, const unsigned char *s, size_t n, ull x) {
+    prefix[0] = 0;
+    for (size_t i = 0; i < n; i++)
+        prefix[i + 1] = reduce(mulMod(prefix[i], x) + s[i]);
+}
+
+/* Builds prefix hashes of P, in O(m); the ones of T are built block by block, by hashBlock().
+T and P must outlive the aligner. */
+void initAligner(Aligner *a, const char *T, size_t lenT, const char *P, size_t lenP) {
+    ull x = a->x = randomBase();
+    a->T = (const unsigned char *)T;
+    a->P = (const unsigned char *)P;
+    a->lenT = lenT;
+    a->lenP = lenP;
+    a->blockStart = 0;
+    a->blockHashed = 0;
+    a->prefixT = malloc((BLOCK_SIZE + lenP) * sizeof(*a->prefixT));
+    a->prefixP = malloc((lenP + 1) * sizeof(*a->prefixP));
+    a->powers = malloc((lenP + 1) * sizeof(*a->powers));
+    if (!a->prefixT || !a->prefixP || !a->powers)               // if malloc fails
+        exit(-1);
+
+    prefixHashes(a->prefixP, a->P, lenP, x);
+    a->powers[0] = 1;
+    for (size_t k = 0; k < lenP; k++)
+        a->powers[k + 1] = mulMod(a->powers[k], x);
+}
+
+void freeAligner(Aligner *a) {
+    free(a->prefixT);
+    free(a->prefixP);
+    free(a->powers);
+}
+
+/* Computes prefix hashes of the text of the current block: all windows of its alignments. */
+void hashBlock(Aligner *a) {
+    size_t end = a->blockStart + BLOCK_SIZE + a->lenP - 1;
+    if (end > a->lenT)
+        end = a->lenT;
+    prefixHashes(a->prefixT, a->T + a->blockStart, end - a->blockStart, a->x);
+    a->blockHashed = 1;
+}
+
+/* Are T[i..i+len) and P[j..j+len) equal? O(1). T[i..i+len) must be in the text of the current block, which must be hashed. */
+int extensionEqual(const Aligner *a, size_t i, size_t j, size_t len) {
+    i -= a->blockStart;
+    ull hT = reduce(a->prefixT[i + len] + PRIME - mulMod(a->prefixT[i], a->powers[len]));
+    ull hP = reduce(a->prefixP[j + len] + PRIME - mulMod(a->prefixP[j], a->powers[len]));
+    return hT == hP;
+}
+
+/* Length of the longest common prefix of T[i..] and P[j..], but at most limit, which must fit into both. O(log L). */
+size_t lce(Aligner *a, size_t i, size_t j, size_t limit) {
+    size_t len = 0;
+    for ( ; len + 8 <= limit && len < DIRECT_COMPARE; len += 8) {
+        ull u, v;
+        memcpy(&u, a->T + i + len, 8);
+        memcpy(&v, a->P + j + len, 8);
+        if (u != v)
+            return len + equalBytes(u, v);
+    }
+    if (len < DIRECT_COMPARE) {                                 // fewer than 8 characters are left
+        while (len < limit && a->T[i + len] == a->P[j + len])
+            len++;
+        return len;
+    }
+    if (len == limit)
+        return len;
+    if (!a->blockHashed)
+        hashBlock(a);
+
+    /* Galloping: the prefixes of length lo are equal, and the ones of length greater than hi can't be. */
+    size_t lo = len, hi = limit, step = DIRECT_COMPARE;
+    while (lo + step < limit) {
+        if (!extensionEqual(a, i, j, lo + step)) {
+            hi = lo + step - 1;
+            break;
+        }
+        lo += step;
+        step <<= 1;
+    }
+    /* Binary search on the length, as in lcp() of "hash_index.c". */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (extensionEqual(a, i, j, mid))
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+/* Number of different bytes of the 8-byte words, whose xor is d. */
+size_t differentBytes(ull d) {
+    ull t = (((d & 0x7f7f7f7f7f7f7f7fllu) + 0x7f7f7f7f7f7f7f7fllu) | d) & 0x8080808080808080llu;     // the high bit of every byte that isn't 0
+    return (size_t)(((t >> 7) * 0x0101010101010101llu) >> 56);
+}
+
+/* Number of mismatches between T[i..i+m) and P, or more than k if there are more than k of them. O(k*log m). */
+size_t mismatches(Aligner *a, size_t i, size_t k) {
+    const unsigned char *T = a->T + i, *P = a->P;
+    size_t m = a->lenP, numMismatches = 0, j = 0;
+    while (j + 8 <= m) {
+        ull u, v;
+        memcpy(&u, T + j, 8);
+        memcpy(&v, P + j, 8);
+        if (u != v) {
+            numMismatches += differentBytes(u ^ v);
+            j += 8;
+        }
+        else {
+            j += lce(a, i + j, j, m - j);
+            if (j == m)
+                break;
+            numMismatches++;                                    // T[j] != P[j]
+            j++;
+        }
+        if (numMismatches > k)
+            return numMismatches;
+    }
+    for ( ; j < m; j++)
+        numMismatches += T[j] != P[j];
+    return numMismatches;
+}
+
+
+/* SEARCH CODE */
+
+typedef struct Matches Matches;
+
+struct Matches {
+    size_t *pos;
+    size_t len, cap;
+};
+
+void addMatch(Matches *m, size_t pos) {
+    if (m->len == m->cap) {
+        m->cap = m->cap ? m->cap << 1 : 16;
+        m->pos = realloc(m->pos, m->cap * sizeof(*m->pos));
+        if (!m->pos)                                            // if realloc fails
+            exit(-1);
+    }
+    m->pos[m->len++] = pos;
+}
+
+void printMatches(const Matches *m) {
+    for (size_t i = 0; i < m->len; i++)
+        printf("%zu ", m->pos[i]);
+    printf("\n");
+}
+
+/* Positions of T where P occurs with at most k mismatches, with LCE jumps. O(n*k*log m). */
+void kMismatchSearch(const char *T, size_t lenT, const char *P, size_t lenP, size_t k, Matches *m) {
+    if (!lenP || lenP > lenT)
+        return;
+
+    Aligner a;
+    initAligner(&a, T, lenT, P, lenP);
+    for (size_t i = 0; i + lenP <= lenT; i++) {
+        if (i - a.blockStart == BLOCK_SIZE) {
+            a.blockStart = i;
+            a.blockHashed = 0;
+        }
+        if (mismatches(&a, i, k) <= k)
+            addMatch(m, i);
+    }
+    freeAligner(&a);
+}
+
+/* The same, naively, in O(n*m): the baseline for the benchmark, and the reference for kMismatchSearch().
+An alignment is still abandoned after k + 1 mismatches, which is what makes it fast on random text. */
+void kMismatchNaive(const char *T, size_t lenT, const char *P, size_t lenP, size_t k, Matches *m) {
+    if (!lenP || lenP > lenT)
+        return;
+
+    for (size_t i = 0; i + lenP <= lenT; i++) {
+        size_t numMismatches = 0;
+        for (size_t j = 0; j < lenP && numMismatches <= k; j++)
+            numMismatches += T[i + j] != P[j];
+        if (numMismatches <= k)
+            addMatch(m, i);
+    }
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Reads the whole file into memory. */
+char *readFile(const char *name, size_t *len) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(*len + 1);
+    if (!buf || fread(buf, 1, *len, f) != *len)
+        exit(-1);
+    buf[*len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* With no arguments, reads k, pattern and text from stdin, in three rows.
+With arguments K PATTERN FILE, searches the file.
+With arguments K PATTERN FILE bench, times kMismatchSearch() and kMismatchNaive(), without printing positions. */
+int main(int argc, char *argv[]) {
+    Matches m = { NULL, 0, 0 };
+    size_t k, lenT;
+    char *text;
+    const char *pattern;
+
+    if (argc < 4) {
+        static char p[MAX_NUM_ITEMS];
+        text = malloc(MAX_NUM_ITEMS);
+        if (!text)                                              // if malloc fails
+            exit(-1);
+        if (scanf("%zu %500000s %500000s", &k, p, text) != 3)
+            return 1;
+        pattern = p;
+        lenT = strlen(text);
+    }
+    else {
+        k = (size_t)atol(argv[1]);
+        pattern = argv[2];
+        text = readFile(argv[3], &lenT);
+    }
+
+    if (argc > 4 && !strcmp(argv[4], "bench")) {
+        double t0 = now();
+        kMismatchSearch(text, lenT, pattern, strlen(pattern), k, &m);
+        double t1 = now();
+        printf("LCE  : %.3f s, %zu matches\n", t1 - t0, m.len);
+        m.len = 0;
+        t0 = now();
+        kMismatchNaive(text, lenT, pattern, strlen(pattern), k, &m);
+        t1 = now();
+        printf("naive: %.3f s, %zu matches\n", t1 - t0, m.len);
+    }
+    else {
+        kMismatchSearch(text, lenT, pattern, strlen(pattern), k, &m);
+        printMatches(&m);
+    }
+
+    free(m.pos);
+    free(text);
+    return 0;
+}
+
+/* Test data:
+
+We should input k and two strings, in three rows, and the result is
+positions where the first string occurs in the second one with at most k mismatches.
+
+Input:
+1
+aba
+abacabbbaca
+Output:
+0 2 4 6 8
+
+Input:
+0
+aba
+abacaba
+Output:
+0 4
+
+Input:
+2
+abcdef
+xbcdyfabcdef
+Output:
+0 6
+*/
+
+#endif // HASH_KMISMATCH
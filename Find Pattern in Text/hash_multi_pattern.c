@@ -0,0 +1,284 @@
+//#define HASH_MULTI_PATTERN
+#ifdef HASH_MULTI_PATTERN
+
+/* Find many patterns in text */
+
+/* Rabin-Karp for a set of patterns.
+Patterns are grouped by length, and hashes of all patterns of one group are kept in a
+compact open-addressing hash set. Every group then needs only one rolling pass over T,
+in which each window hash is looked up in the set of its group.
+So, the cost depends on the number of distinct pattern lengths, and not on the number of patterns.
+
+The window hash is a polynomial one, with X != 1 (as in "Hashing with Chains"),
+because with X == 1 all anagrams of a pattern would have the same hash, and with thousands
+of same-length patterns that would make almost every window a candidate for verification. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NUM_ITEMS 500001                                    // Max length of T. +1 for '\0'.
+#define MAX_PATTERN_LEN 1001                                    // Max length of P. +1 for '\0'.
+#define PRIME 1000000007u
+#define X 263                                                   // Multiplier
+#define GOLDEN 0x9e3779b97f4a7c15llu                            // 2**64 / golden ratio; spreads hashes over the slots of a set
+
+typedef unsigned long long ull;
+
+/* A set of hashes of same-length patterns.
+Open addressing with linear probing; the number of slots is a power of two.
+A slot holds a hash and the index of the first pattern with that hash;
+the other patterns with the same hash (duplicates, or collisions) are chained through next[]. */
+typedef struct Group Group;
+
+struct Group {
+    size_t len;                                                 // length of all patterns in the group
+    size_t mask;                                                // number of slots - 1
+    ull *hashes;                                                // slot hashes
+    int *first;                                                 // index of the first pattern in the slot, or -1 if the slot is empty
+};
+
+typedef struct PatternSet PatternSet;
+
+struct PatternSet {
+    char **patterns;                                            // not owned
+    size_t numPatterns;
+    int *next;                                                  // next pattern with the same hash and length, or -1
+    Group *groups;
+    size_t numGroups;
+};
+
+/* Positions of occurences of one pattern; a growable array. */
+typedef struct Matches Matches;
+
+struct Matches {
+    size_t *pos;
+    size_t len, cap;
+};
+
+/* Hash of the first n characters of s.
+h = s[0]*X**(n-1) + s[1]*X**(n-2) + ... + s[n-1], so that it can be rolled forward. */
+ull hashN(const char *s, size_t n) {
+    const unsigned char *u = (const unsigned char *)s;
+    ull h = 0;
+
+    for (size_t i = 0; i < n; i++)
+        h = (h * X + u[i]) % PRIME;
+
+    return h;
+}
+
+/* Slot where the search for hash h in group g starts. */
+size_t slotOf(const Group *g, ull h) {
+    return (size_t)((h * GOLDEN) >> 32) & g->mask;
+}
+
+/* Returns index of the first pattern in g with hash h, or -1. */
+int lookup(const Group *g, ull h) {
+    for (size_t s = slotOf(g, h); g->first[s] != -1; s = (s + 1) & g->mask) {
+        if (g->hashes[s] == h)
+            return g->first[s];
+    }
+    return -1;
+}
+
+static char **sortPatterns;                                     // used only by compareByLength(), since qsort() doesn't take a context
+
+int compareByLength(const void *a, const void *b) {
+    size_t la = strlen(sortPatterns[*(const int *)a]);
+    size_t lb = strlen(sortPatterns[*(const int *)b]);
+    if (la != lb)
+        return la < lb ? -1 : 1;
+    return *(const int *)a - *(const int *)b;
+}
+
+/* Groups the patterns by length and builds a hash set for every group.
+Empty patterns are ignored. */
+PatternSet *buildPatternSet(char **patterns, size_t numPatterns) {
+    PatternSet *ps = malloc(sizeof(*ps));
+    int *order = malloc(numPatterns * sizeof(*order));
+    if (!ps || !order)                                          // if malloc fails
+        exit(-1);
+    ps->patterns = patterns;
+    ps->numPatterns = numPatterns;
+    ps->next = malloc(numPatterns * sizeof(*ps->next));
+    ps->groups = malloc(numPatterns * sizeof(*ps->groups));     // at most one group per pattern
+    ps->numGroups = 0;
+    if (!ps->next || !ps->groups)
+        exit(-1);
+
+    for (size_t i = 0; i < numPatterns; i++)
+        order[i] = (int)i;
+    sortPatterns = patterns;
+    qsort(order, numPatterns, sizeof(*order), compareByLength);
+
+    for (size_t i = 0, j; i < numPatterns; i = j) {
+        size_t len = strlen(patterns[order[i]]);
+        for (j = i + 1; j < numPatterns && strlen(patterns[order[j]]) == len; j++)
+            ;
+        if (!len)
+            continue;
+
+        /* At least twice as many slots as patterns, so that probe sequences stay short. */
+        size_t numSlots = 2;
+        while (numSlots < 2 * (j - i))
+            numSlots <<= 1;
+
+        Group *g = &ps->groups[ps->numGroups++];
+        g->len = len;
+        g->mask = numSlots - 1;
+        g->hashes = malloc(numSlots * sizeof(*g->hashes));
+        g->first = malloc(numSlots * sizeof(*g->first));
+        if (!g->hashes || !g->first)
+            exit(-1);
+        memset(g->first, -1, numSlots * sizeof(*g->first));
+
+        /* Patterns are inserted in reverse order, so that the chains are in input order. */
+        for (size_t k = j; k-- > i; ) {
+            int p = order[k];
+            ull h = hashN(patterns[p], len);
+            size_t s = slotOf(g, h);
+            while (g->first[s] != -1 && g->hashes[s] != h)
+                s = (s + 1) & g->mask;
+            ps->next[p] = g->first[s];                          // -1 if the slot was empty
+            g->hashes[s] = h;
+            g->first[s] = p;
+        }
+    }
+
+    free(order);
+    return ps;
+}
+
+void freePatternSet(PatternSet *ps) {
+    for (size_t i = 0; i < ps->numGroups; i++) {
+        free(ps->groups[i].hashes);
+        free(ps->groups[i].first);
+    }
+    free(ps->groups);
+    free(ps->next);
+    free(ps);
+}
+
+void addMatch(Matches *m, size_t pos) {
+    if (m->len == m->cap) {
+        m->cap = m->cap ? m->cap << 1 : 16;
+        m->pos = realloc(m->pos, m->cap * sizeof(*m->pos));
+        if (!m->pos)                                            // if realloc fails
+            exit(-1);
+    }
+    m->pos[m->len++] = pos;
+}
+
+/* Finds all occurences of all patterns from ps in T.
+matches has one element per pattern, in the order in which they were given to buildPatternSet().
+Positions are appended in increasing order. */
+void RabinKarpMulti(PatternSet *ps, char *T, Matches *matches) {
+    size_t lenT = strlen(T);
+    const unsigned char *U = (const unsigned char *)T;
+
+    for (size_t gi = 0; gi < ps->numGroups; gi++) {
+        const Group *g = &ps->groups[gi];
+        size_t lenP = g->len;
+        if (lenP > lenT)
+            break;                                              // groups are sorted by length
+
+        /* y == X**(lenP - 1) % PRIME is the weight of the character that leaves the window. */
+        ull y = 1;
+        for (size_t i = 1; i < lenP; i++)
+            y = (y * X) % PRIME;
+
+        ull h = hashN(T, lenP);
+        size_t last = lenT - lenP;
+
+        for (size_t i = 0; ; i++) {
+            for (int p = lookup(g, h); p != -1; p = ps->next[p]) {
+                if (!memcmp(T + i, ps->patterns[p], lenP))
+                    addMatch(&matches[p], i);
+            }
+            if (i == last)
+                break;
+            h = ((h + PRIME - (U[i] * y) % PRIME) * X + U[i + lenP]) % PRIME;
+        }
+    }
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+int main(void) {
+    size_t numPatterns;
+    if (scanf("%zu", &numPatterns) != 1 || !numPatterns)
+        return 0;                                               // no patterns: output has no rows
+
+    char **patterns = malloc(numPatterns * sizeof(*patterns));
+    if (!patterns)                                              // if malloc fails
+        exit(-1);
+    /* A contiguous array of strings (2-D array of chars). */
+    patterns[0] = malloc(numPatterns * MAX_PATTERN_LEN);
+    if (!patterns[0])                                           // if malloc fails
+        exit(-1);
+    for (size_t i = 0; i < numPatterns; i++) {
+        patterns[i] = patterns[0] + i * MAX_PATTERN_LEN;
+        scanf("%1000s", patterns[i]);
+    }
+
+    static char text[MAX_NUM_ITEMS];
+    scanf("%500000s", text);
+
+    PatternSet *ps = buildPatternSet(patterns, numPatterns);
+    Matches *matches = calloc(numPatterns, sizeof(*matches));
+    RabinKarpMulti(ps, text, matches);
+
+    for (size_t i = 0; i < numPatterns; i++) {
+        for (size_t j = 0; j < matches[i].len; j++)
+            printf("%zu ", matches[i].pos[j]);
+        printf("\n");
+        free(matches[i].pos);
+    }
+
+    free(matches);
+    freePatternSet(ps);
+    free(patterns[0]);
+    free(patterns);
+
+    char c = getchar();
+    c = getchar();
+    return 0;
+}
+
+/* Test data:
+
+The first row of input contains number of patterns.
+Each of the following rows contains one pattern, and the last row contains the text.
+Output has one row per pattern, in input order, with positions of its occurences in the text.
+
+Input:
+4
+aba
+caba
+ab
+aba
+abacaba
+Output:
+0 4
+3
+0 4
+0 4
+
+Input:
+3
+Test
+tseT
+xyz
+testTesttesT
+Output:
+4
+
+
+*/
+
+#endif // HASH_MULTI_PATTERN
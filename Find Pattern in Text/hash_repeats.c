@@ -0,0 +1,315 @@
+//#define HASH_REPEATS
+#ifdef HASH_REPEATS
+
+/* Longest repeated substring, and repeated k-grams */
+
+/* Finds the longest substring that occurs at least twice in the text (occurences may overlap),
+or, with -k K, all substrings of length K that occur at least twice.
+
+If a substring of length L occurs twice, then so does its prefix of length L - 1,
+so the answer can be found by binary search on L. The search gallops first (L == 1, 2, 4, ...),
+since in most texts the longest repeat is much shorter than the text, and rounds that find no repeat
+are the expensive ones, because they can't stop early. Every round rolls the window hash of length L
+over the text, as in "hash_substring_alt.c" (modulo 2**61 - 1, with a random base x),
+and puts the window fingerprints into a hash set; the first fingerprint that's already there,
+and whose windows are really equal (memcmp()), proves a repeat.
+A round takes O(n) expected time, so the whole search takes O(n log n).
+
+The set holds one position per fingerprint. Two different windows would have to collide modulo 2**61 - 1
+for a repeat to be hidden by that, which is practically impossible. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <intrin.h>                                             // _umul128()
+#endif // _MSC_VER
+
+#define PRIME 2305843009213693951llu                            // 2**61 - 1
+#define POWER 61                                                // PRIME == 2**POWER - 1
+#define M 0x1fffffffffffffffllu
+#define Q 61
+#define R 0x1fffffffffffffffllu
+#define GOLDEN 0x9e3779b97f4a7c15llu                            // 2**64 / golden ratio; spreads fingerprints over the slots of the set
+#define READ_CHUNK (1u << 20)
+
+typedef unsigned long long ull;
+
+/* HASH CODE */
+
+/* h % PRIME, for h < 2**(2*POWER).
+http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivision */
+ull reduce(ull h) {
+    /* h % PRIME goes into m (modulus) */
+    ull m;
+
+    m = (h & M) + ((h >> POWER) & M);
+
+    for ( ; m > PRIME; )
+        m = (m >> Q) + (m & R);
+
+    return m == PRIME ? 0 : m;
+}
+
+/* a * b % PRIME, for a, b < PRIME. */
+ull mulMod(ull a, ull b) {
+#ifdef _MSC_VER
+    ull hi, lo = _umul128(a, b, &hi);
+    return reduce((lo & M) + ((lo >> POWER) | (hi << (64 - POWER))));
+#else
+    unsigned __int128 p = (unsigned __int128)a * b;
+    return reduce(((ull)p & M) + (ull)(p >> POWER));
+#endif // _MSC_VER
+}
+
+/* A random base in [2, PRIME - 1], from splitmix64 (http://xorshift.di.unimi.it/splitmix64.c). */
+ull randomBase(void) {
+    static ull state = 0;
+    if (!state)
+        state = (ull)time(NULL) ^ ((ull)clock() << 32) ^ (ull)(size_t)&state;
+
+    ull z = (state += 0x9e3779b97f4a7c15llu);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9llu;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebllu;
+    z = z ^ (z >> 31);
+
+    return 2 + z % (PRIME - 2);
+}
+
+
+/* FINGERPRINT SET CODE */
+
+/* Open addressing with linear probing. The number of slots is a power of two, at least 1.5 times the number of windows.
+Slots aren't cleared between rounds: a slot is in use only if its stamp is equal to the current round.
+All fields of a slot are kept together (24 bytes), in one array, so a probe reads the key, position and stamp
+with one access, and a linear probe goes on to the adjacent slot, which is often in the same cache line. */
+typedef struct Slot Slot;
+
+struct Slot {
+    ull key;
+    size_t pos;                                                 // position of the first window with the fingerprint
+    unsigned count;                                             // number of windows with the fingerprint
+    unsigned stamp;
+};
+
+typedef struct FingerprintSet FingerprintSet;
+
+struct FingerprintSet {
+    int bits;                                                   // number of slots == 2**bits
+    Slot *slots;
+    unsigned round;
+};
+
+FingerprintSet *makeSet(size_t maxWindows) {
+    FingerprintSet *s = malloc(sizeof(*s));
+    if (!s)                                                     // if malloc fails
+        exit(-1);
+    for (s->bits = 1; ((size_t)1 << s->bits) < maxWindows + maxWindows / 2; s->bits++)
+        ;
+    s->slots = calloc((size_t)1 << s->bits, sizeof(*s->slots));
+    if (!s->slots)
+        exit(-1);
+    s->round = 0;
+    return s;
+}
+
+void freeSet(FingerprintSet *s) {
+    free(s->slots);
+    free(s);
+}
+
+/* Finds the slot of fingerprint h, or the empty slot where it should go. */
+Slot *findSlot(const FingerprintSet *s, ull h) {
+    size_t mask = ((size_t)1 << s->bits) - 1;
+    size_t i = (size_t)((h * GOLDEN) >> (64 - s->bits));
+    while (s->slots[i].stamp == s->round && s->slots[i].key != h)
+        i = (i + 1) & mask;
+    return &s->slots[i];
+}
+
+
+/* REPEATS CODE */
+
+/* Rolls the window hash of length L over T, and inserts the fingerprints into the set, in a new round.
+If stopAtRepeat is set, stops at the first window that is equal to an earlier one, and returns TRUE,
+with their positions in first and second. Otherwise, it counts all windows per fingerprint, and returns FALSE. */
+int rollRound(FingerprintSet *s, const unsigned char *T, size_t n, size_t L, int stopAtRepeat,
+              size_t *first, size_t *second) {
+    s->round++;
+    ull x = randomBase();
+    ull y = 1;                                                  // y == x**L is the weight that the character leaving the window would have
+    ull h = 0;
+    for (size_t i = 0; i < L; i++) {
+        h = reduce(mulMod(h, x) + T[i]);
+        y = mulMod(y, x);
+    }
+
+    for (size_t i = 0; ; i++) {
+        Slot *slot = findSlot(s, h);
+        if (slot->stamp != s->round) {
+            slot->stamp = s->round;
+            slot->key = h;
+            slot->pos = i;
+            slot->count = 1;
+        }
+        else if (!memcmp(T + slot->pos, T + i, L)) {
+            slot->count++;
+            if (stopAtRepeat) {
+                *first = slot->pos;
+                *second = i;
+                return 1;
+            }
+        }
+        if (i + L == n)
+            break;
+        h = reduce(mulMod(h, x) + T[i + L] + PRIME - mulMod(y, T[i]));     // h = h*x + T[i + L] - y*T[i]
+    }
+    return 0;
+}
+
+/* Length of the longest substring of T that occurs at least twice. Its two positions go to first and second. */
+size_t longestRepeat(const unsigned char *T, size_t n, size_t *first, size_t *second) {
+    size_t lo = 0, hi = n ? n - 1 : 0;                          // a repeat of length lo exists, and none is longer than hi
+    *first = *second = 0;
+    if (n < 2)
+        return 0;
+
+    FingerprintSet *s = makeSet(n);
+    size_t f, g;
+
+    /* Galloping: doubles lo while there are repeats of length 2*lo. */
+    for (size_t len = 1; len <= hi; len <<= 1) {
+        if (!rollRound(s, T, n, len, 1, &f, &g)) {
+            hi = len - 1;
+            break;
+        }
+        lo = len;
+        *first = f;
+        *second = g;
+    }
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (rollRound(s, T, n, mid, 1, &f, &g)) {
+            lo = mid;
+            *first = f;
+            *second = g;
+        }
+        else
+            hi = mid - 1;
+    }
+    freeSet(s);
+    return lo;
+}
+
+/* Prints every substring of length k that occurs at least twice, as its first position and its number of occurences,
+in order of first positions. Returns the number of such substrings. */
+size_t printRepeats(const unsigned char *T, size_t n, size_t k) {
+    if (!k || k > n)
+        return 0;
+
+    FingerprintSet *s = makeSet(n - k + 1);
+    size_t dummy, numRepeats = 0;
+    rollRound(s, T, n, k, 0, &dummy, &dummy);
+
+    /* Slots are in hash order; positions of first occurences are marked in a bitmap, to print them in text order. */
+    unsigned char *isFirst = calloc(n - k + 1, 1);
+    unsigned *counts = malloc((n - k + 1) * sizeof(*counts));
+    if (!isFirst || !counts)
+        exit(-1);
+    for (size_t i = 0; i < ((size_t)1 << s->bits); i++) {
+        const Slot *slot = &s->slots[i];
+        if (slot->stamp == s->round && slot->count > 1) {
+            isFirst[slot->pos] = 1;
+            counts[slot->pos] = slot->count;
+        }
+    }
+    for (size_t i = 0; i < n - k + 1; i++) {
+        if (isFirst[i]) {
+            printf("%zu %u\n", i, counts[i]);
+            numRepeats++;
+        }
+    }
+
+    free(isFirst);
+    free(counts);
+    freeSet(s);
+    return numRepeats;
+}
+
+/* Reads all of f into memory. */
+unsigned char *readAll(FILE *f, size_t *len) {
+    size_t cap = READ_CHUNK, n;
+    unsigned char *buf = malloc(cap);
+    *len = 0;
+    while (buf && (n = fread(buf + *len, 1, cap - *len, f)) > 0) {
+        *len += n;
+        if (*len == cap)
+            buf = realloc(buf, cap <<= 1);
+    }
+    if (!buf)                                                   // if malloc or realloc fails
+        exit(-1);
+    return buf;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* Usage: hash_repeats [-k K] [FILE]
+Reads the text from FILE, or from stdin. The text is binary data; new lines are part of it. */
+int main(int argc, char *argv[]) {
+    size_t k = 0;
+    int a = 1;
+    if (a + 1 < argc && !strcmp(argv[a], "-k")) {
+        k = (size_t)strtoull(argv[a + 1], NULL, 10);
+        a += 2;
+    }
+
+    FILE *f = a < argc ? fopen(argv[a], "rb") : stdin;
+    if (!f) {
+        perror(argv[a]);
+        return 1;
+    }
+    size_t n;
+    unsigned char *T = readAll(f, &n);
+    if (f != stdin)
+        fclose(f);
+
+    if (k)
+        printRepeats(T, n, k);
+    else {
+        size_t first, second;
+        size_t len = longestRepeat(T, n, &first, &second);
+        printf("%zu", len);
+        if (len)
+            printf(" %zu %zu", first, second);
+        printf("\n");
+    }
+
+    free(T);
+    return 0;
+}
+
+/* Test data:
+
+Output is the length of the longest repeated substring, and two of its positions.
+With -k K, output has one row per repeated substring of length K: its first position and its number of occurences.
+
+Input (printf "banana" | hash_repeats):
+banana
+Output:
+3 1 3
+
+Input (printf "abcabcabc" | hash_repeats -k 3):
+abcabcabc
+Output:
+0 3
+1 2
+2 2
+*/
+
+#endif // HASH_REPEATS
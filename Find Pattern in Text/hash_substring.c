@@ -9,7 +9,20 @@
 which makes sense to me. That's why results between different variants don't vary much.
 Things like loop unrolling, loop interchange, hacks for modulo division, and similar
 should be benchmarked in a large loop, with time measured inside of compilation unit,
-without printing results of algorithms. */
+without printing results of algorithms.
+That's why the matchers hand results to a MatchSink: SINK_COUNT doesn't print anything,
+and SINK_WRITE prints through a large buffer, instead of calling printf() per result.
+
+With RK_STATS defined, the matchers count what they do, and time their phases with a monotonic clock,
+and main() prints that to stderr, in JSON, so that it's clear where the time of a slow search goes:
+    window_hashes    number of window hashes computed,
+    candidates       windows whose hash is equal to the pattern hash, which are verified,
+    false_positives  candidates that aren't occurences (spurious hits),
+    bytes_compared   bytes compared during verification,
+    seconds          per phase: "hash" (hashing P, and precomputeHashes()), "scan" (the loop over windows, with
+                     verification, and formatting of positions with SINK_WRITE), "read" (stream mode) and "output".
+Window hashes are counted once per call, and the rest only on hash hits, so the loop over windows stays the same.
+Without RK_STATS, all of it compiles to nothing. */
 
 
 #define _CRT_SECURE_NO_WARNINGS
@@ -19,8 +32,17 @@ without printing results of algorithms. */
 #include <string.h>
 #include <time.h>
 
+//#define RK_STATS
+
+#ifdef RK_STATS
+#ifdef _WIN32
+#include <windows.h>                                            // QueryPerformanceCounter()
+#endif // _WIN32
+#endif // RK_STATS
+
 #define MAX_NUM_ITEMS 500001                                    // Max lengthf of P and T. +1 for '\0'.
 #define MAX_P_OCCURENCES_LEN 100000000
+#define CHUNK_SIZE (1u << 24)                                   // Stream mode reads the text in chunks of this many bytes (16 MiB).
 #define TRUE 1
 #define FALSE 0
 #define PRIME 1000000007u                                       // This is a good choice.
@@ -35,6 +57,181 @@ x should be in [1, PRIME - 1]. x == 1 is the fastest.
 x can be chosen randomly in run-time, or hard-coded. */
 size_t x;
 
+/* STATISTICS CODE */
+
+#ifdef RK_STATS
+
+typedef struct RKStats RKStats;
+
+struct RKStats {
+    ull windowHashes;
+    ull candidates;
+    ull falsePositives;
+    ull bytesCompared;
+    double hashSeconds, scanSeconds, readSeconds, outputSeconds;
+};
+
+RKStats rkStats;
+
+/* Seconds from an arbitrary point, from a clock that never goes back. */
+double monotonicSeconds(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif // _WIN32
+}
+
+/* strncmp() and memcmp() of a candidate, which also count it, and the bytes they compare. */
+int countingStrncmp(const char *a, const char *b, size_t n) {
+    size_t i = 0;
+    while (i < n && a[i] == b[i] && a[i])
+        i++;
+    int result = i < n ? (unsigned char)a[i] - (unsigned char)b[i] : 0;
+    rkStats.candidates++;
+    rkStats.bytesCompared += i < n ? i + 1 : n;
+    rkStats.falsePositives += result != 0;
+    return result;
+}
+
+int countingMemcmp(const void *a, const void *b, size_t n) {
+    const unsigned char *u = a, *v = b;
+    size_t i = 0;
+    while (i < n && u[i] == v[i])
+        i++;
+    int result = i < n ? u[i] - v[i] : 0;
+    rkStats.candidates++;
+    rkStats.bytesCompared += i < n ? i + 1 : n;
+    rkStats.falsePositives += result != 0;
+    return result;
+}
+
+void printStatsJSON(FILE *f) {
+    fprintf(f, "{\"window_hashes\": %llu, \"candidates\": %llu, \"false_positives\": %llu, \"bytes_compared\": %llu, "
+            "\"seconds\": {\"hash\": %.6f, \"scan\": %.6f, \"read\": %.6f, \"output\": %.6f}}\n",
+            rkStats.windowHashes, rkStats.candidates, rkStats.falsePositives, rkStats.bytesCompared,
+            rkStats.hashSeconds, rkStats.scanSeconds, rkStats.readSeconds, rkStats.outputSeconds);
+}
+
+#define STATS_ADD(field, n) (rkStats.field += (n))
+#define STATS_START(t) double t = monotonicSeconds()
+#define STATS_STOP(field, t) (rkStats.field += monotonicSeconds() - (t))
+#define STRNCMP countingStrncmp
+#define MEMCMP countingMemcmp
+
+#else
+
+#define STATS_ADD(field, n)
+#define STATS_START(t)
+#define STATS_STOP(field, t)
+#define STRNCMP strncmp
+#define MEMCMP memcmp
+
+#endif // RK_STATS
+
+/* MATCH SINK CODE */
+
+/* Matchers don't print positions of occurences themselves, but hand them to a sink,
+so that their speed can be measured without the cost of printing.
+The same code is in all hash_substring*.c files; MATCH_SINK lets them be compiled together. */
+#ifndef MATCH_SINK
+#define MATCH_SINK
+
+#define OUT_BUF_SIZE (1u << 20)                                 // Size of the output buffer of writeNumber().
+
+/* Sink modes */
+#define SINK_BUFFER 0                                           // Appends positions to a growable buffer.
+#define SINK_COUNT 1                                            // Only counts matches.
+#define SINK_FIRST_K 2                                          // Appends positions to a growable buffer, and stops the matcher after the first limit of them.
+#define SINK_WRITE 3                                            // Formats positions with writeNumber().
+
+typedef struct MatchSink MatchSink;
+
+struct MatchSink {
+    int mode;
+    size_t count;                                               // number of matches so far
+    size_t limit;                                               // used with SINK_FIRST_K only; must be at least 1
+    ull *pos;                                                   // used with SINK_BUFFER and SINK_FIRST_K only
+    size_t cap;
+};
+
+static char outBuf[OUT_BUF_SIZE];
+static size_t outLen = 0;
+
+/* Writes the output buffer with one large fwrite(), which goes straight to one write() system call. */
+void flushOutput(void) {
+    fwrite(outBuf, 1, outLen, stdout);
+    outLen = 0;
+}
+
+/* Fast formatter.
+Appends decimal v and a space to the output buffer, and flushes it only when it's full. */
+void writeNumber(ull v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (outLen + n + 1 > OUT_BUF_SIZE)
+        flushOutput();
+    while (n)
+        outBuf[outLen++] = digits[--n];
+    outBuf[outLen++] = ' ';
+}
+
+/* Ends the row of positions, and flushes the output buffer. */
+void writeNewLine(void) {
+    if (outLen == OUT_BUF_SIZE)
+        flushOutput();
+    outBuf[outLen++] = '\n';
+    flushOutput();
+}
+
+MatchSink makeSink(int mode, size_t limit) {
+    MatchSink sink = { mode, 0, limit, NULL, 0 };
+    return sink;
+}
+
+/* Hands one position to the sink.
+Returns TRUE if the matcher should go on, or FALSE if it should stop. */
+int sinkAdd(MatchSink *sink, ull pos) {
+    switch (sink->mode) {
+    case SINK_COUNT:
+        sink->count++;
+        return TRUE;
+    case SINK_WRITE:
+        writeNumber(pos);
+        sink->count++;
+        return TRUE;
+    default:                                                    // SINK_BUFFER or SINK_FIRST_K
+        if (sink->count == sink->cap) {
+            sink->cap = sink->cap ? sink->cap << 1 : 16;
+            sink->pos = realloc(sink->pos, sink->cap * sizeof(*sink->pos));
+            if (!sink->pos)                                     // if realloc fails
+                exit(-1);
+        }
+        sink->pos[sink->count++] = pos;
+        return sink->mode == SINK_BUFFER || sink->count < sink->limit;
+    }
+}
+
+void freeSink(MatchSink *sink) {
+    free(sink->pos);
+    sink->pos = NULL;
+    sink->count = sink->cap = 0;
+}
+
+#endif // MATCH_SINK
+
+
+/* RABIN-KARP CODE */
+
 ull hash(char *s) {
     ull h = 0;
     size_t slen = strlen(s);
@@ -48,6 +245,7 @@ ull hash(char *s) {
 ull *precomputeHashes(char *T, size_t lenT, size_t lenP) {
     ull *H = NULL;
     H = malloc((lenT - lenP + 1) * sizeof(*H));
+    STATS_ADD(windowHashes, lenT - lenP + 1);
 
     H[lenT - lenP] = hash(T + lenT - lenP);                     // T + lenT - lenP <==> &T[lenT - lenP], but it's probably faster.
     ull y = 1;
@@ -74,35 +272,178 @@ ull *precomputeHashes(char *T, size_t lenT, size_t lenP) {
     return H;
 }
 
-void RabinKarp(char *T, char *P) {
+void RabinKarp(char *T, char *P, MatchSink *sink) {
     size_t lenT = strlen(T);
     size_t lenP = strlen(P);
     //x = MR + rand() / (RAND_MAX / (NR - MR + 1) + 1);           // rand() returns int
     x = 1;                                                      // This is just fine. It's the fastest.
+    STATS_START(tHash);
     ull pHash = hash(P);
     ull *H = NULL;
     H = precomputeHashes(T, lenT, lenP);
+    STATS_STOP(hashSeconds, tHash);
+    STATS_START(tScan);
     for (size_t i = 0; i < lenT - lenP + 1; i++) {
         if (pHash != H[i])
             continue;
-        if (!strncmp(T + i, P, lenP))                           // T + i <==> &T[i], but probably faster.
-            printf("%u ", i);
+        if (!STRNCMP(T + i, P, lenP) && !sinkAdd(sink, i))     // T + i <==> &T[i], but probably faster.
+            break;
     }
-    printf("\n");
+    STATS_STOP(scanSeconds, tScan);
     free(H);
 }
 
-int main(void) {
+/* Hash of the first n characters of s.
+Works on unsigned chars, so that the window hashes in RabinKarpFused() are
+exact sums modulo PRIME even for bytes larger than 127. */
+ull hashN(const char *s, size_t n) {
+    const unsigned char *u = (const unsigned char *)s;
+    ull h = 0;
+
+    for (size_t i = 0; i < n; i++)
+        h = (h + u[i]) % PRIME;                                 // h = (h * x + s[i]) % PRIME; in general case, but with reversed order of coefficients
+
+    return h;
+}
+
+/* Single-pass variant of RabinKarp().
+It doesn't materialize H[], which takes (lenT - lenP + 1) * 8 bytes, and
+it doesn't walk T backwards before scanning it for the second time.
+Instead, it rolls the window hash forward, compares it to the pattern hash,
+and verifies a candidate in the same pass, using O(1) extra memory.
+Reports the same positions as RabinKarp(). */
+void RabinKarpFused(char *T, char *P, MatchSink *sink) {
+    size_t lenT = strlen(T);
+    size_t lenP = strlen(P);
+    x = 1;                                                      // This is just fine. It's the fastest.
+
+    if (lenP > lenT)
+        return;
+
+    const unsigned char *U = (const unsigned char *)T;
+    STATS_START(tHash);
+    ull pHash = hashN(P, lenP);
+    ull h = hashN(T, lenP);
+    size_t last = lenT - lenP, i;
+    STATS_STOP(hashSeconds, tHash);
+
+    STATS_START(tScan);
+    for (i = 0; ; i++) {
+        if (pHash == h && !STRNCMP(T + i, P, lenP) && !sinkAdd(sink, i))
+            break;
+        if (i == last)
+            break;
+        h = (h + PRIME - U[i] + U[i + lenP]) % PRIME;           // (x*h + PRIME - y*T[i] + T[i + lenP]) % PRIME in general case (y == x**lenP)
+    }
+    STATS_ADD(windowHashes, i + 1);
+    STATS_STOP(scanSeconds, tScan);
+}
+
+/* Stream variant of RabinKarpFused().
+Reads the text from f in chunks of CHUNK_SIZE bytes, instead of holding all of it in memory,
+so it works with files of any size (multi-GB logs, too), with O(lenP + CHUNK_SIZE) memory.
+The rolling hash is carried across chunk boundaries, and so are the last lenP bytes of a chunk:
+lenP - 1 of them overlap the next chunk, and one more is the byte that leaves the window on the next roll.
+That's why matches that straddle a chunk boundary are found, too.
+Text is treated as binary data, so whitespace and '\0' are just bytes like any other,
+and positions are absolute offsets in the file. */
+void RabinKarpStream(FILE *f, char *P, size_t lenP, MatchSink *sink) {
+    if (!lenP)
+        return;
+
+    unsigned char *buf = malloc(lenP + CHUNK_SIZE);
+    if (!buf)                                                   // if malloc fails
+        exit(-1);
+
+    /* Fills the buffer with at least one whole window, if there is one. */
+    size_t have = 0, n;
+    STATS_START(tRead);
+    while (have < lenP && (n = fread(buf + have, 1, lenP + CHUNK_SIZE - have, f)) > 0)
+        have += n;
+    STATS_STOP(readSeconds, tRead);
+    if (have < lenP) {
+        free(buf);
+        return;
+    }
+
+    STATS_START(tHash);
+    ull pHash = hashN(P, lenP);
+    ull h = hashN((char *)buf, lenP);
+    STATS_STOP(hashSeconds, tHash);
+    ull base = 0;                                               // offset of buf[0] in the file
+    size_t i = 0;                                               // window start, relative to buf
+
+#ifdef RK_STATS
+    double readBefore = rkStats.readSeconds;
+#endif // RK_STATS
+    STATS_START(tScan);
+    for (;;) {
+        if (pHash == h && !MEMCMP(buf + i, P, lenP) && !sinkAdd(sink, base + i))
+            break;
+        if (i + lenP == have) {
+            /* The window has reached the end of the buffer: keep it, and append the next chunk after it. */
+            memmove(buf, buf + i, lenP);
+            base += i;
+            i = 0;
+            have = lenP;
+            STATS_START(tRead);
+            n = fread(buf + have, 1, CHUNK_SIZE, f);
+            STATS_STOP(readSeconds, tRead);
+            if (!n)
+                break;
+            have += n;
+        }
+        h = (h + PRIME - buf[i] + buf[i + lenP]) % PRIME;       // (x*h + PRIME - y*T[i] + T[i + lenP]) % PRIME in general case (y == x**lenP)
+        i++;
+    }
+    STATS_ADD(windowHashes, base + i + 1);
+    STATS_STOP(scanSeconds, tScan);
+#ifdef RK_STATS
+    rkStats.scanSeconds -= rkStats.readSeconds - readBefore;    // reading isn't scanning
+#endif // RK_STATS
+    free(buf);
+}
+
+/* With no arguments, reads pattern and text from stdin, as before.
+With two arguments, argv[1] is the pattern and argv[2] is the name of the text file ("-" for stdin),
+which is searched in stream mode, by RabinKarpStream(). */
+int main(int argc, char *argv[]) {
     /* Intializes random number generator */
     time_t t;
     srand((unsigned)time(&t));
 
+    if (argc == 3) {
+        FILE *f = strcmp(argv[2], "-") ? fopen(argv[2], "rb") : stdin;
+        if (!f) {
+            perror(argv[2]);
+            return 1;
+        }
+        MatchSink sink = makeSink(SINK_WRITE, 0);
+        RabinKarpStream(f, argv[1], strlen(argv[1]), &sink);
+        STATS_START(tOutput);
+        writeNewLine();
+        STATS_STOP(outputSeconds, tOutput);
+#ifdef RK_STATS
+        printStatsJSON(stderr);
+#endif // RK_STATS
+        if (f != stdin)
+            fclose(f);
+        return 0;
+    }
+
     static char pattern[MAX_NUM_ITEMS], text[MAX_NUM_ITEMS];
 
     scanf("%s", pattern);
     scanf("%s", text);
 
-    RabinKarp(text, pattern);
+    MatchSink sink = makeSink(SINK_WRITE, 0);
+    RabinKarpFused(text, pattern, &sink);                       // RabinKarp(text, pattern, &sink); is the two-pass variant
+    STATS_START(tOutput);
+    writeNewLine();
+    STATS_STOP(outputSeconds, tOutput);
+#ifdef RK_STATS
+    printStatsJSON(stderr);
+#endif // RK_STATS
 
     char c = getchar();
     c = getchar();
@@ -131,6 +472,20 @@ aaaaa
 baaaaaaa
 Output:
 1 2 3
+
+Stream mode:
+hash_substring "dolor sit" big.log
+Output:
+positions (byte offsets) of all occurences of "dolor sit" in big.log, in one row
+
+With RK_STATS defined:
+Input:
+ab
+abba
+Output:
+0
+Statistics (stderr; x == 1, so "ba" has the hash of "ab", and it's a spurious hit):
+{"window_hashes": 3, "candidates": 2, "false_positives": 1, "bytes_compared": 3, "seconds": {"hash": 0.000000, "scan": 0.000001, "read": 0.000000, "output": 0.000004}}
 */
 
 #endif // HASH_SUBSTRING 
\ No newline at end of file
@@ -15,7 +15,9 @@ so they are unsigned, instead of signed (as in the original). */
 which makes sense to me. That's why results between different variants don't vary much.
 Things like loop unrolling, loop interchange, hacks for modulo division, and similar
 should be benchmarked in a large loop, with time measured inside of compilation unit,
-without printing results of algorithms. */
+without printing results of algorithms.
+That's why the matchers hand results to a MatchSink: SINK_COUNT doesn't print anything,
+and SINK_WRITE prints through a large buffer, instead of calling printf() per result. */
 
 
 #define _CRT_SECURE_NO_WARNINGS
@@ -41,6 +43,104 @@ x should be in [1, PRIME - 1]. x == 1 is the fastest.
 x can be chosen randomly in run-time, or hard-coded. */
 size_t x;
 
+/* MATCH SINK CODE */
+
+/* Matchers don't print positions of occurences themselves, but hand them to a sink,
+so that their speed can be measured without the cost of printing.
+The same code is in all hash_substring*.c files; MATCH_SINK lets them be compiled together. */
+#ifndef MATCH_SINK
+#define MATCH_SINK
+
+#define OUT_BUF_SIZE (1u << 20)                                 // Size of the output buffer of writeNumber().
+
+/* Sink modes */
+#define SINK_BUFFER 0                                           // Appends positions to a growable buffer.
+#define SINK_COUNT 1                                            // Only counts matches.
+#define SINK_FIRST_K 2                                          // Appends positions to a growable buffer, and stops the matcher after the first limit of them.
+#define SINK_WRITE 3                                            // Formats positions with writeNumber().
+
+typedef struct MatchSink MatchSink;
+
+struct MatchSink {
+    int mode;
+    size_t count;                                               // number of matches so far
+    size_t limit;                                               // used with SINK_FIRST_K only; must be at least 1
+    ull *pos;                                                   // used with SINK_BUFFER and SINK_FIRST_K only
+    size_t cap;
+};
+
+static char outBuf[OUT_BUF_SIZE];
+static size_t outLen = 0;
+
+/* Writes the output buffer with one large fwrite(), which goes straight to one write() system call. */
+void flushOutput(void) {
+    fwrite(outBuf, 1, outLen, stdout);
+    outLen = 0;
+}
+
+/* Fast formatter.
+Appends decimal v and a space to the output buffer, and flushes it only when it's full. */
+void writeNumber(ull v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (outLen + n + 1 > OUT_BUF_SIZE)
+        flushOutput();
+    while (n)
+        outBuf[outLen++] = digits[--n];
+    outBuf[outLen++] = ' ';
+}
+
+/* Ends the row of positions, and flushes the output buffer. */
+void writeNewLine(void) {
+    if (outLen == OUT_BUF_SIZE)
+        flushOutput();
+    outBuf[outLen++] = '\n';
+    flushOutput();
+}
+
+MatchSink makeSink(int mode, size_t limit) {
+    MatchSink sink = { mode, 0, limit, NULL, 0 };
+    return sink;
+}
+
+/* Hands one position to the sink.
+Returns TRUE if the matcher should go on, or FALSE if it should stop. */
+int sinkAdd(MatchSink *sink, ull pos) {
+    switch (sink->mode) {
+    case SINK_COUNT:
+        sink->count++;
+        return TRUE;
+    case SINK_WRITE:
+        writeNumber(pos);
+        sink->count++;
+        return TRUE;
+    default:                                                    // SINK_BUFFER or SINK_FIRST_K
+        if (sink->count == sink->cap) {
+            sink->cap = sink->cap ? sink->cap << 1 : 16;
+            sink->pos = realloc(sink->pos, sink->cap * sizeof(*sink->pos));
+            if (!sink->pos)                                     // if realloc fails
+                exit(-1);
+        }
+        sink->pos[sink->count++] = pos;
+        return sink->mode == SINK_BUFFER || sink->count < sink->limit;
+    }
+}
+
+void freeSink(MatchSink *sink) {
+    free(sink->pos);
+    sink->pos = NULL;
+    sink->count = sink->cap = 0;
+}
+
+#endif // MATCH_SINK
+
+
+/* RABIN-KARP CODE */
+
 ull hash(char *s) {
     ull h = 0;
     size_t slen = strlen(s);
@@ -135,7 +235,7 @@ ull *precomputeHashes(char *T, size_t lenT, size_t lenP) {
     return H;
 }
 
-void RabinKarp(char *T, char *P) {
+void RabinKarp(char *T, char *P, MatchSink *sink) {
     size_t lenT = strlen(T);
     size_t lenP = strlen(P);
     //x = MR + rand() / (RAND_MAX / (NR - MR + 1) + 1);           // rand() returns int
@@ -155,25 +255,95 @@ void RabinKarp(char *T, char *P) {
     size_t mod = count & 7u;
 
     while (repeat--) {
-        if (pHash == H[i] && !strncmp(T + i, P, lenP)) printf("%u ", i);    // T + i <==> &T[i], but probably faster.
-        if (pHash == H[i+1] && !strncmp(T + i + 1, P, lenP)) printf("%u ", i + 1);
-        if (pHash == H[i+2] && !strncmp(T + i + 2, P, lenP)) printf("%u ", i + 2);
-        if (pHash == H[i+3] && !strncmp(T + i + 3, P, lenP)) printf("%u ", i + 3);
-        if (pHash == H[i+4] && !strncmp(T + i + 4, P, lenP)) printf("%u ", i + 4);
-        if (pHash == H[i+5] && !strncmp(T + i + 5, P, lenP)) printf("%u ", i + 5);
-        if (pHash == H[i+6] && !strncmp(T + i + 6, P, lenP)) printf("%u ", i + 6);
-        if (pHash == H[i+7] && !strncmp(T + i + 7, P, lenP)) printf("%u ", i + 7);
+        if (pHash == H[i] && !strncmp(T + i, P, lenP) && !sinkAdd(sink, i)) goto done;    // T + i <==> &T[i], but probably faster.
+        if (pHash == H[i+1] && !strncmp(T + i + 1, P, lenP) && !sinkAdd(sink, i + 1)) goto done;
+        if (pHash == H[i+2] && !strncmp(T + i + 2, P, lenP) && !sinkAdd(sink, i + 2)) goto done;
+        if (pHash == H[i+3] && !strncmp(T + i + 3, P, lenP) && !sinkAdd(sink, i + 3)) goto done;
+        if (pHash == H[i+4] && !strncmp(T + i + 4, P, lenP) && !sinkAdd(sink, i + 4)) goto done;
+        if (pHash == H[i+5] && !strncmp(T + i + 5, P, lenP) && !sinkAdd(sink, i + 5)) goto done;
+        if (pHash == H[i+6] && !strncmp(T + i + 6, P, lenP) && !sinkAdd(sink, i + 6)) goto done;
+        if (pHash == H[i+7] && !strncmp(T + i + 7, P, lenP) && !sinkAdd(sink, i + 7)) goto done;
 
         i += 8;
     }
 
     for (; i < count; i++)
-        if (pHash == H[i] && !strncmp(T + i, P, lenP)) printf("%u ", i);
+        if (pHash == H[i] && !strncmp(T + i, P, lenP) && !sinkAdd(sink, i)) break;
 
-    printf("\n");
+done:                                                           // The sink doesn't want any more matches.
     free(H);
 }
 
+/* Hash of the first n characters of s.
+Works on unsigned chars, so that the window hashes in RabinKarpFused() are
+exact sums modulo PRIME even for bytes larger than 127. */
+ull hashN(const char *s, size_t n) {
+    const unsigned char *u = (const unsigned char *)s;
+    ull h = 0;
+    register size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        h = (h + u[i]) % PRIME;                                 // h = (h * x + s[i]) % PRIME; in general case, but with reversed order of coefficients
+        h = (h + u[i+1]) % PRIME;
+        h = (h + u[i+2]) % PRIME;
+        h = (h + u[i+3]) % PRIME;
+        h = (h + u[i+4]) % PRIME;
+        h = (h + u[i+5]) % PRIME;
+        h = (h + u[i+6]) % PRIME;
+        h = (h + u[i+7]) % PRIME;
+    }
+
+    for (; i < n; i++)
+        h = (h + u[i]) % PRIME;
+
+    return h;
+}
+
+/* Single-pass variant of RabinKarp().
+It doesn't materialize H[], which takes (lenT - lenP + 1) * 8 bytes, and
+it doesn't walk T backwards before scanning it for the second time.
+Instead, it rolls the window hash forward, compares it to the pattern hash,
+and verifies a candidate in the same pass, using O(1) extra memory.
+Reports the same positions as RabinKarp().
+The loop is unrolled 8 times, like the one in RabinKarp(). */
+void RabinKarpFused(char *T, char *P, MatchSink *sink) {
+    size_t lenT = strlen(T);
+    size_t lenP = strlen(P);
+    x = 1;                                                      // This is just fine. It's the fastest.
+
+    if (lenP > lenT)
+        return;
+
+    const unsigned char *U = (const unsigned char *)T;
+    ull pHash = hashN(P, lenP);
+    ull h = hashN(T, lenP);
+
+    /* Every step first checks the window at i, and then rolls h to the window at i + 1.
+    The last window (at count - 1) is checked after the loops, because there's nothing to roll it to. */
+    register size_t i = 0;
+    size_t count = lenT - lenP;
+    size_t repeat = count >> 3;
+    size_t mod = count & 7u;
+
+#define STEP(j) \
+    if (pHash == h && !strncmp(T + i + (j), P, lenP) && !sinkAdd(sink, i + (j))) return; \
+    h = (h + PRIME - U[i + (j)] + U[i + (j) + lenP]) % PRIME;  // (x*h + PRIME - y*T[i] + T[i + lenP]) % PRIME in general case (y == x**lenP)
+
+    while (repeat--) {
+        STEP(0) STEP(1) STEP(2) STEP(3) STEP(4) STEP(5) STEP(6) STEP(7)
+        i += 8;
+    }
+
+    for (; mod; mod--, i++) {
+        STEP(0)
+    }
+
+#undef STEP
+
+    if (pHash == h && !strncmp(T + i, P, lenP))
+        sinkAdd(sink, i);
+}
+
 int main(void) {
     /* Intializes random number generator */
     time_t t;
@@ -184,7 +354,9 @@ int main(void) {
     scanf("%s", pattern);
     scanf("%s", text);
 
-    RabinKarp(text, pattern);
+    MatchSink sink = makeSink(SINK_WRITE, 0);
+    RabinKarpFused(text, pattern, &sink);                       // RabinKarp(text, pattern, &sink); is the two-pass variant
+    writeNewLine();
 
     char c = getchar();
     c = getchar();
@@ -0,0 +1,483 @@
+//#define HASH_SUBSTRING_ADAPTIVE
+#ifdef HASH_SUBSTRING_ADAPTIVE
+
+/* Find pattern in text, with the engine chosen for the pattern */
+
+/* No one search algorithm is the fastest for all patterns:
+    - a single byte is found fastest by memchr(), which the C library implements with SIMD,
+    - a short pattern that contains a byte that is rare in the text is found fastest by memchr() of that byte,
+      with verification of the window around every hit: the text is scanned at memchr() speed, and hits are rare,
+    - a long pattern is found fastest by an algorithm that skips: Two-Way (Crochemore and Perrin, 1991),
+      which is what the C library uses for memmem() and strstr(), with the bad-character shift of Horspool,
+      which skips up to lenP bytes at a time. Unlike Horspool alone, it's O(n + m) in the worst case,
+      and it uses O(1) memory beside the shift table,
+    - and Rabin-Karp is left for patterns without rare bytes, whose skips would be short.
+
+The length of a pattern alone doesn't tell whether skips are long: in DNA, every long pattern contains all four bases
+near its end, so the bad-character shift is mostly 1 to 4 bytes, and Two-Way is slower than Rabin-Karp.
+That's why makeSearcher() looks at a sample of the text, too. It counts the bytes of the sample,
+and then it knows both which byte of the pattern is the rarest one, and what the average shift would be.
+The rules are:
+    - one byte: memchr,
+    - a byte of the pattern is rare (at most one in RARE_BYTE_RATIO bytes of the sample): rare byte,
+    - the average bad-character shift over the sample is at least MIN_AVERAGE_SHIFT: Two-Way,
+    - otherwise: Rabin-Karp.
+makeSearcher() chooses the engine and does all preprocessing, once; then search() can be called for any number of texts.
+Every engine hands positions to a MatchSink, so they can be compared with SINK_COUNT, without printing.
+
+The rolling hash of the Rabin-Karp engine is modulo 2**32 with an odd multiplier, as in "hash_substring_simd.c",
+and hash hits are verified, so all engines report exactly the same positions.
+
+With SEARCH_DEBUG defined, makeSearcher() logs its decision and the reasons for it to stderr,
+so that choices can be checked on real corpora. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//#define SEARCH_DEBUG
+
+#define MAX_NUM_ITEMS 500001                                    // Max length of P and T in stdin mode. +1 for '\0'.
+#define TRUE 1
+#define FALSE 0
+#define SAMPLE_SIZE (1u << 16)                                  // Byte frequencies are counted in this many bytes of the beginning of the text.
+#define RARE_BYTE_RATIO 16                                      // A byte is rare if at most one in this many sampled bytes is equal to it.
+#define MIN_AVERAGE_SHIFT 8                                     // Two-Way is used if its bad-character shift would be at least this many bytes, on average.
+#define X 0x01000193u                                           // Multiplier of the Rabin-Karp engine; odd, so that it's invertible modulo 2**32.
+
+typedef unsigned long long ull;
+typedef unsigned int uint;
+
+/* MATCH SINK CODE */
+
+/* Matchers don't print positions of occurences themselves, but hand them to a sink,
+so that their speed can be measured without the cost of printing.
+The same code is in all hash_substring*.c files; MATCH_SINK lets them be compiled together. */
+#ifndef MATCH_SINK
+#define MATCH_SINK
+
+#define OUT_BUF_SIZE (1u << 20)                                 // Size of the output buffer of writeNumber().
+
+/* Sink modes */
+#define SINK_BUFFER 0                                           // Appends positions to a growable buffer.
+#define SINK_COUNT 1                                            // Only counts matches.
+#define SINK_FIRST_K 2                                          // Appends positions to a growable buffer, and stops the matcher after the first limit of them.
+#define SINK_WRITE 3                                            // Formats positions with writeNumber().
+
+typedef struct MatchSink MatchSink;
+
+struct MatchSink {
+    int mode;
+    size_t count;                                               // number of matches so far
+    size_t limit;                                               // used with SINK_FIRST_K only; must be at least 1
+    ull *pos;                                                   // used with SINK_BUFFER and SINK_FIRST_K only
+    size_t cap;
+};
+
+static char outBuf[OUT_BUF_SIZE];
+static size_t outLen = 0;
+
+/* Writes the output buffer with one large fwrite(), which goes straight to one write() system call. */
+void flushOutput(void) {
+    fwrite(outBuf, 1, outLen, stdout);
+    outLen = 0;
+}
+
+/* Fast formatter.
+Appends decimal v and a space to the output buffer, and flushes it only when it's full. */
+void writeNumber(ull v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (outLen + n + 1 > OUT_BUF_SIZE)
+        flushOutput();
+    while (n)
+        outBuf[outLen++] = digits[--n];
+    outBuf[outLen++] = ' ';
+}
+
+/* Ends the row of positions, and flushes the output buffer. */
+void writeNewLine(void) {
+    if (outLen == OUT_BUF_SIZE)
+        flushOutput();
+    outBuf[outLen++] = '\n';
+    flushOutput();
+}
+
+MatchSink makeSink(int mode, size_t limit) {
+    MatchSink sink = { mode, 0, limit, NULL, 0 };
+    return sink;
+}
+
+/* Hands one position to the sink.
+Returns TRUE if the matcher should go on, or FALSE if it should stop. */
+int sinkAdd(MatchSink *sink, ull pos) {
+    switch (sink->mode) {
+    case SINK_COUNT:
+        sink->count++;
+        return TRUE;
+    case SINK_WRITE:
+        writeNumber(pos);
+        sink->count++;
+        return TRUE;
+    default:                                                    // SINK_BUFFER or SINK_FIRST_K
+        if (sink->count == sink->cap) {
+            sink->cap = sink->cap ? sink->cap << 1 : 16;
+            sink->pos = realloc(sink->pos, sink->cap * sizeof(*sink->pos));
+            if (!sink->pos)                                     // if realloc fails
+                exit(-1);
+        }
+        sink->pos[sink->count++] = pos;
+        return sink->mode == SINK_BUFFER || sink->count < sink->limit;
+    }
+}
+
+void freeSink(MatchSink *sink) {
+    free(sink->pos);
+    sink->pos = NULL;
+    sink->count = sink->cap = 0;
+}
+
+#endif // MATCH_SINK
+
+
+/* ENGINE CODE */
+
+/* Engines */
+#define ENGINE_NONE 0                                           // An empty pattern, or one longer than the text; nothing to find.
+#define ENGINE_MEMCHR 1
+#define ENGINE_RARE_BYTE 2
+#define ENGINE_RABIN_KARP 3
+#define ENGINE_TWO_WAY 4
+#define NUM_ENGINES 5
+
+static const char *ENGINE_NAMES[NUM_ENGINES] = { "none", "memchr", "rare byte", "Rabin-Karp", "Two-Way" };
+
+typedef struct Searcher Searcher;
+
+struct Searcher {
+    const unsigned char *P;                                     // not owned
+    size_t lenP;
+    int engine;
+    size_t rare;                                                // position of the rarest byte of P in the text sample
+    uint pHash;                                                 // Rabin-Karp: hash of P
+    uint xPower;                                                // Rabin-Karp: X**lenP
+    size_t critical;                                            // Two-Way: P is split into P[0..critical] and P[critical + 1..lenP); (size_t)-1 if the left part is empty
+    size_t period;                                              // Two-Way: the shift after the left part matches
+    size_t memory0;                                             // Two-Way: the length of the prefix that is known to match after that shift; 0 if P isn't periodic
+    size_t last[256];                                           // Two-Way: 1 + position of the last occurence of a byte in P, or 0
+};
+
+/* Position of the maximal suffix of P, according to the byte order (reverse == FALSE) or the opposite one (reverse == TRUE),
+and the period of that suffix, in *period. Returns (size_t)-1 if the suffix is all of P. O(m). */
+size_t maximalSuffix(const unsigned char *P, size_t lenP, int reverse, size_t *period) {
+    size_t i = (size_t)-1, j = 0, k = 1, p = 1;                 // i + 1 is the start of the suffix, j + 1 of the candidate, and p its period
+    while (j + k < lenP) {
+        unsigned char a = P[i + k], b = P[j + k];
+        if (a == b) {
+            if (k == p) {
+                j += p;
+                k = 1;
+            }
+            else
+                k++;
+        }
+        else if ((a > b) != reverse) {
+            j += k;
+            k = 1;
+            p = j - i;
+        }
+        else {
+            i = j++;
+            k = p = 1;
+        }
+    }
+    *period = p;
+    return i;
+}
+
+/* Critical factorization of P, and its period, for Two-Way. O(m). */
+void initTwoWay(Searcher *s) {
+    const unsigned char *P = s->P;
+    size_t lenP = s->lenP, p, q;
+    size_t i = maximalSuffix(P, lenP, FALSE, &p);
+    size_t j = maximalSuffix(P, lenP, TRUE, &q);
+    if (j + 1 > i + 1) {                                        // the later of the two maximal suffixes gives a critical factorization
+        i = j;
+        p = q;
+    }
+    s->critical = i;
+    if (i + 1 + p <= lenP && !memcmp(P, P + p, i + 1)) {        // P is periodic with period p
+        s->period = p;
+        s->memory0 = lenP - p;
+    }
+    else {
+        s->period = (i + 1 > lenP - i - 1 ? i + 1 : lenP - i - 1) + 1;
+        s->memory0 = 0;
+    }
+
+    memset(s->last, 0, sizeof(s->last));
+    for (size_t k = 0; k < lenP; k++)
+        s->last[P[k]] = k + 1;
+}
+
+/* Chooses the engine for P, and prepares all of them. The sample is the beginning of the text, or any text like it. */
+Searcher makeSearcher(const char *P, size_t lenP, const char *sample, size_t lenSample) {
+    Searcher s;
+    s.P = (const unsigned char *)P;
+    s.lenP = lenP;
+    s.rare = 0;
+
+    size_t count[256] = { 0 };
+    const unsigned char *u = (const unsigned char *)sample;
+    if (lenSample > SAMPLE_SIZE)
+        lenSample = SAMPLE_SIZE;
+    for (size_t i = 0; i < lenSample; i++)
+        count[u[i]]++;
+    for (size_t i = 1; i < lenP; i++) {
+        if (count[s.P[i]] < count[s.P[s.rare]])
+            s.rare = i;
+    }
+
+    s.pHash = 0;
+    s.xPower = 1;
+    for (size_t i = 0; i < lenP; i++) {
+        s.pHash = s.pHash * X + s.P[i];
+        s.xPower *= X;
+    }
+
+    initTwoWay(&s);
+
+    /* The sum of bad-character shifts at all sampled bytes, if they were the last byte of a window. */
+    ull sumShifts = 0;
+    for (int c = 0; c < 256; c++)
+        sumShifts += (ull)count[c] * (lenP - s.last[c]);
+
+    if (!lenP)
+        s.engine = ENGINE_NONE;
+    else if (lenP == 1)
+        s.engine = ENGINE_MEMCHR;
+    else if (count[s.P[s.rare]] * RARE_BYTE_RATIO <= lenSample)
+        s.engine = ENGINE_RARE_BYTE;
+    else if (sumShifts >= (ull)MIN_AVERAGE_SHIFT * lenSample)
+        s.engine = ENGINE_TWO_WAY;
+    else
+        s.engine = ENGINE_RABIN_KARP;
+
+#ifdef SEARCH_DEBUG
+    if (lenP)
+        fprintf(stderr, "search: pattern length %zu, rarest byte 0x%02x at %zu, %zu times in %zu sampled bytes, "
+                "average shift %.1f, critical position %zu, period %zu%s: %s\n",
+                lenP, s.P[s.rare], s.rare, count[s.P[s.rare]], lenSample, lenSample ? (double)sumShifts / lenSample : 0.0,
+                s.critical + 1, s.period, s.memory0 ? " (periodic)" : "", ENGINE_NAMES[s.engine]);
+    else
+        fprintf(stderr, "search: empty pattern: %s\n", ENGINE_NAMES[s.engine]);
+#endif // SEARCH_DEBUG
+
+    return s;
+}
+
+/* P is a single byte: memchr() finds it. */
+void searchMemchr(const Searcher *s, const unsigned char *T, size_t lenT, MatchSink *sink) {
+    const unsigned char *p = T, *end = T + lenT;
+    for ( ; p < end && (p = memchr(p, s->P[0], end - p)); p++) {
+        if (!sinkAdd(sink, p - T))
+            return;
+    }
+}
+
+/* memchr() finds the rarest byte of P, and every hit is verified. */
+void searchRareByte(const Searcher *s, const unsigned char *T, size_t lenT, MatchSink *sink) {
+    size_t r = s->rare;
+    const unsigned char *p = T + r, *end = T + lenT - (s->lenP - 1 - r);       // the rare byte of the last window is at end - 1
+    for ( ; p < end && (p = memchr(p, s->P[r], end - p)); p++) {
+        if (!memcmp(p - r, s->P, s->lenP) && !sinkAdd(sink, p - r - T))
+            return;
+    }
+}
+
+/* Rabin-Karp, with a forward rolling hash modulo 2**32; hash hits are verified. */
+void searchRabinKarp(const Searcher *s, const unsigned char *T, size_t lenT, MatchSink *sink) {
+    size_t lenP = s->lenP, last = lenT - lenP;
+    uint h = 0;
+    for (size_t i = 0; i < lenP; i++)
+        h = h * X + T[i];
+
+    for (size_t i = 0; ; i++) {
+        if (h == s->pHash && !memcmp(T + i, s->P, lenP) && !sinkAdd(sink, i))
+            return;
+        if (i == last)
+            break;
+        h = h * X + T[i + lenP] - s->xPower * T[i];
+    }
+}
+
+/* Two-Way: the last byte of the window is checked first, and a mismatch skips by the bad-character shift;
+then the right part of P is compared left to right, and a mismatch in it skips past the mismatch;
+then the left part is compared right to left, and the window is shifted by the period.
+If P is periodic, memory is the length of the prefix of the window that is known to match, and isn't compared again. */
+void searchTwoWay(const Searcher *s, const unsigned char *T, size_t lenT, MatchSink *sink) {
+    const unsigned char *P = s->P;
+    size_t lenP = s->lenP, critical = s->critical, memory = 0, k;
+    for (size_t i = 0; i + lenP <= lenT; ) {
+        k = lenP - s->last[T[i + lenP - 1]];
+        if (k) {
+            i += k > memory ? k : memory;
+            memory = 0;
+            continue;
+        }
+        for (k = critical + 1 > memory ? critical + 1 : memory; k < lenP && P[k] == T[i + k]; k++)
+            ;
+        if (k < lenP) {
+            i += k - critical;
+            memory = 0;
+            continue;
+        }
+        for (k = critical + 1; k > memory && P[k - 1] == T[i + k - 1]; k--)
+            ;
+        if (k <= memory && !sinkAdd(sink, i))
+            return;
+        i += s->period;
+        memory = s->memory0;
+    }
+}
+
+/* Hands positions of all occurences of P in T to the sink, with the engine that makeSearcher() chose. */
+void search(const Searcher *s, const char *T, size_t lenT, MatchSink *sink) {
+    const unsigned char *U = (const unsigned char *)T;
+    if (!s->lenP || s->lenP > lenT)
+        return;
+
+    switch (s->engine) {
+    case ENGINE_MEMCHR:
+        searchMemchr(s, U, lenT, sink);
+        break;
+    case ENGINE_RARE_BYTE:
+        searchRareByte(s, U, lenT, sink);
+        break;
+    case ENGINE_RABIN_KARP:
+        searchRabinKarp(s, U, lenT, sink);
+        break;
+    case ENGINE_TWO_WAY:
+        searchTwoWay(s, U, lenT, sink);
+        break;
+    }
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Reads the whole file into memory. */
+char *readFile(const char *name, size_t *len) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(*len + 1);
+    if (!buf || fread(buf, 1, *len, f) != *len)
+        exit(-1);
+    buf[*len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* With no arguments, reads pattern and text from stdin, as "hash_substring.c" does.
+With arguments PATTERN FILE, searches the file.
+With arguments PATTERN FILE bench, times every engine that can search for the pattern, and tells which one was chosen.
+With arguments PATTERN FILE ENGINE, searches the file with the given engine (memchr, rare, rk or twoway). */
+int main(int argc, char *argv[]) {
+    MatchSink sink = makeSink(SINK_WRITE, 0);
+
+    if (argc < 3) {
+        static char pattern[MAX_NUM_ITEMS], text[MAX_NUM_ITEMS];
+        scanf("%500000s", pattern);
+        scanf("%500000s", text);
+        Searcher s = makeSearcher(pattern, strlen(pattern), text, strlen(text));
+        search(&s, text, strlen(text), &sink);
+        writeNewLine();
+        return 0;
+    }
+
+    size_t lenT;
+    char *text = readFile(argv[2], &lenT);
+    Searcher s = makeSearcher(argv[1], strlen(argv[1]), text, lenT);
+
+    if (argc > 3 && !strcmp(argv[3], "bench")) {
+        int chosen = s.engine;
+        for (int e = ENGINE_MEMCHR; e < NUM_ENGINES; e++) {
+            if (e == ENGINE_MEMCHR && s.lenP != 1)
+                continue;
+            s.engine = e;
+            sink = makeSink(SINK_COUNT, 0);
+            double t0 = now();
+            search(&s, text, lenT, &sink);
+            double t1 = now();
+            printf("%-10s: %.3f s, %.2f GB/s, %zu matches%s\n", ENGINE_NAMES[e], t1 - t0,
+                   lenT / (t1 - t0) * 1e-9, sink.count, e == chosen ? " (chosen)" : "");
+        }
+    }
+    else {
+        if (argc > 3) {
+            static const char *options[NUM_ENGINES] = { "", "memchr", "rare", "rk", "twoway" };
+            for (int e = ENGINE_MEMCHR; e < NUM_ENGINES; e++) {
+                if (!strcmp(argv[3], options[e]) && (e != ENGINE_MEMCHR || s.lenP == 1))
+                    s.engine = e;
+            }
+        }
+        search(&s, text, lenT, &sink);
+        writeNewLine();
+    }
+
+    free(text);
+    return 0;
+}
+
+/* Test data:
+
+We should input two strings, in two rows, and the result is
+positions of occurences of the first string in the second one.
+
+Input:
+aba
+abacaba
+Output:
+0 4
+
+Input (a single byte):
+a
+abacaba
+Output:
+0 2 4 6
+
+Input (a long periodic pattern):
+abababababababababababababababab
+abababababababababababababababababab
+Output:
+0 2 4
+
+Benchmark (hash_substring_adaptive "the quick brown fox jumped over the lazy dog" english.txt bench):
+Output is the time of every engine, and the one that was chosen, like (100 MB of text):
+rare byte : 0.021 s, 4.69 GB/s, 0 matches (chosen)
+Rabin-Karp: 0.238 s, 0.42 GB/s, 0 matches
+Two-Way   : 0.047 s, 2.13 GB/s, 0 matches
+*/
+
+#endif // HASH_SUBSTRING_ADAPTIVE
@@ -8,7 +8,11 @@ Namely, PRIME is chosen as the first larger power of two minus one, of
 a previously selected prime, so that the functions can work faster
 (at least in theory). Here, they don't use % operator, but
 "bit twiddling hacks".
-http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivisionParallel */
+http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivisionParallel
+
+Unlike the other variants, this one uses a strong polynomial hash: a random base x
+modulo the Mersenne prime 2**61 - 1 (GIGANTIC_PRIME), with a 128-bit multiply,
+so that spurious matches (hash hits that strncmp() rejects) practically never happen. */
 
 /* PRIME == 1000000007u and (PRIME == 2305843009213693951llu with x == 32) give the same execution speed. */
 
@@ -16,7 +20,9 @@ http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivisionParallel */
 which makes sense to me. That's why results between different variants don't vary much.
 Things like loop unrolling, loop interchange, hacks for modulo division, and similar
 should be benchmarked in a large loop, with time measured inside of compilation unit,
-without printing results of algorithms. */
+without printing results of algorithms.
+That's why the matchers hand results to a MatchSink: SINK_COUNT doesn't print anything,
+and SINK_WRITE prints through a large buffer, instead of calling printf() per result. */
 
 
 #define _CRT_SECURE_NO_WARNINGS
@@ -25,15 +31,15 @@ without printing results of algorithms. */
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#ifdef _MSC_VER
+#include <intrin.h>                                             // _umul128()
+#endif // _MSC_VER
 
 #define MAX_NUM_ITEMS 500001                                    // Max lengthf of P and T. +1 for '\0'
 #define MAX_P_OCCURENCES_LEN 100000000
 #define TRUE 1
 #define FALSE 0
-#define MR 1                                                    // Inclusive lower bound for x when generating it randomly.
-#define NR PRIME - 1                                            // Inclusive upper bound for x when generating it randomly.
-
-//#define GIGANTIC_PRIME
+#define GIGANTIC_PRIME
 #ifdef GIGANTIC_PRIME
 #define PRIME 2305843009213693951llu                            // This is the first prime that is equal a power of two minus one that is larger than 10**14 + 31.
 #define POWER 61                                                // PRIME == 2**POWER - 1
@@ -50,105 +56,264 @@ without printing results of algorithms. */
 
 typedef unsigned long long ull;
 
-/* x is used in hash() and precomputeHashes(), but I set x to 1 (in RabinKarp()), which is fine.
-x should be in [1, PRIME - 1]. x == 1 is the fastest.
-x can be chosen randomly in run-time, or hard-coded. */
-size_t x;
-
-/* Hash function for strings.
-http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivision
-The three constants used in this function are what I think they should be. */
-ull hash(char *s) {
-    ull h = 0;
-    size_t slen = strlen(s);
-
-    for (register int i = slen - 1; i >= 0; --i) {
-        h = h + s[i];                                           // h = h*x + s[i]; in general case, but h << 0 should be faster - this is like x is 1 (h = ((h << 0) + s[i]);)
+/* x is the base of the polynomial hash, used in hash(), precomputeHashes() and hashN().
+It's chosen randomly in run-time, in RabinKarp() and RabinKarpFused(), by randomBase().
+x should be in [2, PRIME - 1]. x == 1 would be the fastest, but then the hash of a string
+is just the sum of its characters, so every anagram of P collides with it, and on repetitive
+data almost every window falls through to strncmp(), which makes the search quadratic.
+With a random x modulo 2**61 - 1, the probability that a window collides with P is
+at most lenP / PRIME, which is practically zero, whatever the data. */
+ull x;
+
+/* MATCH SINK CODE */
+
+/* Matchers don't print positions of occurences themselves, but hand them to a sink,
+so that their speed can be measured without the cost of printing.
+The same code is in all hash_substring*.c files; MATCH_SINK lets them be compiled together. */
+#ifndef MATCH_SINK
+#define MATCH_SINK
+
+#define OUT_BUF_SIZE (1u << 20)                                 // Size of the output buffer of writeNumber().
+
+/* Sink modes */
+#define SINK_BUFFER 0                                           // Appends positions to a growable buffer.
+#define SINK_COUNT 1                                            // Only counts matches.
+#define SINK_FIRST_K 2                                          // Appends positions to a growable buffer, and stops the matcher after the first limit of them.
+#define SINK_WRITE 3                                            // Formats positions with writeNumber().
+
+typedef struct MatchSink MatchSink;
+
+struct MatchSink {
+    int mode;
+    size_t count;                                               // number of matches so far
+    size_t limit;                                               // used with SINK_FIRST_K only; must be at least 1
+    ull *pos;                                                   // used with SINK_BUFFER and SINK_FIRST_K only
+    size_t cap;
+};
+
+static char outBuf[OUT_BUF_SIZE];
+static size_t outLen = 0;
+
+/* Writes the output buffer with one large fwrite(), which goes straight to one write() system call. */
+void flushOutput(void) {
+    fwrite(outBuf, 1, outLen, stdout);
+    outLen = 0;
+}
 
-        /* h % PRIME goes into m (modulus) */
-        ull m;
+/* Fast formatter.
+Appends decimal v and a space to the output buffer, and flushes it only when it's full. */
+void writeNumber(ull v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (outLen + n + 1 > OUT_BUF_SIZE)
+        flushOutput();
+    while (n)
+        outBuf[outLen++] = digits[--n];
+    outBuf[outLen++] = ' ';
+}
 
-        m = (h & M) + ((h >> POWER) & M);
+/* Ends the row of positions, and flushes the output buffer. */
+void writeNewLine(void) {
+    if (outLen == OUT_BUF_SIZE)
+        flushOutput();
+    outBuf[outLen++] = '\n';
+    flushOutput();
+}
 
-        for ( ; m > PRIME; )
-            m = (m >> Q) + (m & R);
+MatchSink makeSink(int mode, size_t limit) {
+    MatchSink sink = { mode, 0, limit, NULL, 0 };
+    return sink;
+}
 
-        h = m == PRIME ? 0 : m;
+/* Hands one position to the sink.
+Returns TRUE if the matcher should go on, or FALSE if it should stop. */
+int sinkAdd(MatchSink *sink, ull pos) {
+    switch (sink->mode) {
+    case SINK_COUNT:
+        sink->count++;
+        return TRUE;
+    case SINK_WRITE:
+        writeNumber(pos);
+        sink->count++;
+        return TRUE;
+    default:                                                    // SINK_BUFFER or SINK_FIRST_K
+        if (sink->count == sink->cap) {
+            sink->cap = sink->cap ? sink->cap << 1 : 16;
+            sink->pos = realloc(sink->pos, sink->cap * sizeof(*sink->pos));
+            if (!sink->pos)                                     // if realloc fails
+                exit(-1);
+        }
+        sink->pos[sink->count++] = pos;
+        return sink->mode == SINK_BUFFER || sink->count < sink->limit;
     }
+}
 
-    return h;
+void freeSink(MatchSink *sink) {
+    free(sink->pos);
+    sink->pos = NULL;
+    sink->count = sink->cap = 0;
 }
 
-ull *precomputeHashes(char *T, size_t lenT, size_t lenP) {
-    ull *H = NULL;
-    H = malloc((lenT - lenP + 1) * sizeof(*H));
+#endif // MATCH_SINK
 
-    H[lenT - lenP] = hash(T + lenT - lenP);                     // T + lenT - lenP <==> &T[lenT - lenP], but it's probably faster.
-    ull y = 1;
 
-    /* q and r are left here as an example, but we use Q and R instead. */
-    //static const size_t q = 61;
-    //static const ull r = 0x1fffffffffffffffllu;
+/* RABIN-KARP CODE */
 
-    /* y % PRIME or H[i] % PRIME go into m (modulus) */
+/* h % PRIME, for h < 2**(2*POWER).
+http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivision
+The three constants used in this function are what I think they should be. */
+ull reduce(ull h) {
+    /* h % PRIME goes into m (modulus) */
     ull m;
 
-    /* This loop is unnecessary when x == 1. */
-    for (size_t i = 1; i < lenP + 1; i++) {
-        //y <<= 0;                                                // y = y * x; in general case, but y << 0 should be faster - this is like x is 1 (y <<= 0;)
+    m = (h & M) + ((h >> POWER) & M);
 
-        m = (y & M) + ((y >> POWER) & M);
+    for ( ; m > PRIME; )
+        m = (m >> Q) + (m & R);
 
-        for ( ; m > PRIME; )
-            m = (m >> Q) + (m & R);
+    return m == PRIME ? 0 : m;
+}
 
-        y = m == PRIME ? 0 : m;
-    }
+/* a * b % PRIME, for a, b < PRIME.
+With GIGANTIC_PRIME, the product has up to 122 bits, so it needs a 128-bit multiply.
+Its high part (above bit 61) and low part are then added, as in reduce(), since 2**61 == 1 (mod PRIME). */
+ull mulMod(ull a, ull b) {
+#ifdef GIGANTIC_PRIME
+#ifdef _MSC_VER
+    ull hi, lo = _umul128(a, b, &hi);
+    return reduce((lo & M) + ((lo >> POWER) | (hi << (64 - POWER))));
+#else
+    unsigned __int128 p = (unsigned __int128)a * b;
+    return reduce(((ull)p & M) + (ull)(p >> POWER));
+#endif // _MSC_VER
+#else
+    return reduce(a * b);                                       // a * b < 2**62
+#endif // GIGANTIC_PRIME
+}
 
-    for (int i = lenT - lenP - 1; i > -1; --i) {                // i has to be signed here!
-        H[i] = H[i + 1] + T[i] - y*T[i + lenP];                 // x*H[i+1] in general case
-        /* Instead of that, if needed, we can write:
-        H[i] = (x*H[i + 1] + T[i] + PRIME - y*T[i + lenP]) % PRIME;
-        or
-        H[i] = (((x*H[i + 1] + T[i] - y*T[i + lenP]) % PRIME) + PRIME) % PRIME;
-        But, the above works, and it's fastest.
-        */
+/* A random base in [2, PRIME - 1].
+rand() gives only 15 bits with some compilers, so the seed is mixed with splitmix64 instead
+(http://xorshift.di.unimi.it/splitmix64.c). */
+ull randomBase(void) {
+    static ull state = 0;
+    if (!state)
+        state = (ull)time(NULL) ^ ((ull)clock() << 32) ^ (ull)(size_t)&state;
 
-        m = (H[i] & M) + ((H[i] >> POWER) & M);
+    ull z = (state += 0x9e3779b97f4a7c15llu);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9llu;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebllu;
+    z = z ^ (z >> 31);
 
-        for ( ; m > PRIME; )
-            m = (m >> Q) + (m & R);
+    return 2 + z % (PRIME - 2);
+}
 
-        H[i] = m == PRIME ? 0 : m;
-    }
+/* Hash function for strings.
+h = s[0] + s[1]*x + s[2]*x**2 + ... (mod PRIME) */
+ull hash(char *s) {
+    const unsigned char *u = (const unsigned char *)s;
+    ull h = 0;
+    size_t slen = strlen(s);
+
+    for (register int i = slen - 1; i >= 0; --i)
+        h = reduce(mulMod(h, x) + u[i]);                        // h = h*x + s[i];
+
+    return h;
+}
+
+ull *precomputeHashes(char *T, size_t lenT, size_t lenP) {
+    const unsigned char *U = (const unsigned char *)T;
+    ull *H = NULL;
+    H = malloc((lenT - lenP + 1) * sizeof(*H));
+
+    H[lenT - lenP] = hash(T + lenT - lenP);                     // T + lenT - lenP <==> &T[lenT - lenP], but it's probably faster.
+    ull y = 1;
+
+    /* y == x**lenP % PRIME */
+    for (size_t i = 1; i < lenP + 1; i++)
+        y = mulMod(y, x);
+
+    /* Both terms are less than PRIME, and so is the subtrahend, so H[i] can't underflow. */
+    for (int i = lenT - lenP - 1; i > -1; --i)                  // i has to be signed here!
+        H[i] = reduce(mulMod(x, H[i + 1]) + U[i] + PRIME - mulMod(y, U[i + lenP]));
 
     return H;
 }
 
-void RabinKarp(char *T, char *P) {
+void RabinKarp(char *T, char *P, MatchSink *sink) {
     size_t lenT = strlen(T);
     size_t lenP = strlen(P);
-    //x = MR + rand() / (RAND_MAX / (NR - MR + 1) + 1);           // rand() returns int, and N is huge, so x is int
+    x = randomBase();
     ull pHash = hash(P);
     ull *H = NULL;
     H = precomputeHashes(T, lenT, lenP);
     for (size_t i = 0; i < lenT - lenP + 1; i++) {
         if (pHash != H[i])
             continue;
-        if (!strncmp(T + i, P, lenP))                           // T + i <==> &T[i], but probably faster.
-            printf("%u ", i);
+        if (!strncmp(T + i, P, lenP) && !sinkAdd(sink, i))     // T + i <==> &T[i], but probably faster.
+            break;
     }
-    printf("\n");
     free(H);
 }
 
+/* Hash of the first n characters of s.
+h = s[0]*x**(n-1) + s[1]*x**(n-2) + ... + s[n-1] (mod PRIME)
+This is hash() with reversed order of coefficients, so that it can be rolled forward. */
+ull hashN(const char *s, size_t n) {
+    const unsigned char *u = (const unsigned char *)s;
+    ull h = 0;
+
+    for (size_t i = 0; i < n; i++)
+        h = reduce(mulMod(h, x) + u[i]);                        // h = h*x + s[i];
+
+    return h;
+}
+
+/* Single-pass variant of RabinKarp().
+It doesn't materialize H[], which takes (lenT - lenP + 1) * 8 bytes, and
+it doesn't walk T backwards before scanning it for the second time.
+Instead, it rolls the window hash forward, compares it to the pattern hash,
+and verifies a candidate in the same pass, using O(1) extra memory.
+Reports the same positions as RabinKarp(). */
+void RabinKarpFused(char *T, char *P, MatchSink *sink) {
+    size_t lenT = strlen(T);
+    size_t lenP = strlen(P);
+
+    if (lenP > lenT)
+        return;
+
+    x = randomBase();
+    const unsigned char *U = (const unsigned char *)T;
+    ull pHash = hashN(P, lenP);
+    ull h = hashN(T, lenP);
+    size_t last = lenT - lenP;
+
+    /* y == x**lenP % PRIME is the weight that the character leaving the window would have. */
+    ull y = 1;
+    for (size_t i = 1; i < lenP + 1; i++)
+        y = mulMod(y, x);
+
+    for (size_t i = 0; ; i++) {
+        if (pHash == h && !strncmp(T + i, P, lenP) && !sinkAdd(sink, i))
+            return;
+        if (i == last)
+            break;
+        h = reduce(mulMod(h, x) + U[i + lenP] + PRIME - mulMod(y, U[i]));     // h = h*x + T[i + lenP] - y*T[i]
+    }
+}
+
 int main(void) {
     static char pattern[MAX_NUM_ITEMS], text[MAX_NUM_ITEMS];
 
     scanf("%s", pattern);
     scanf("%s", text);
 
-    RabinKarp(text, pattern);
+    MatchSink sink = makeSink(SINK_WRITE, 0);
+    RabinKarpFused(text, pattern, &sink);                       // RabinKarp(text, pattern, &sink); is the two-pass variant
+    writeNewLine();
 
     char c = getchar();
     c = getchar();
@@ -0,0 +1,325 @@
+//#define HASH_SUBSTRING_BATCH
+#ifdef HASH_SUBSTRING_BATCH
+
+/* Find pattern in text, for many pairs of pattern and text */
+
+/* "hash_substring.c" searches one pattern in one text per run. With hundreds of thousands of small pairs,
+starting a process per pair, and malloc() and free() of H[] per search, cost much more than the search itself.
+This program searches all pairs in one run, and allocates almost nothing per pair:
+
+  - Input is read by one buffered reader, in blocks of READ_BUF_SIZE bytes, and its rows are copied
+    into an arena, which is reused for every batch: a batch is at most MAX_BATCH_PAIRS pairs, or about
+    MAX_BATCH_BYTES bytes of rows, and then the arena is reset (not freed), so after the first few batches
+    it's large enough, and there is no more allocation.
+  - Search is the single-pass Rabin-Karp of RabinKarpFused(), with a rolling hash, so there is no H[] at all.
+  - Positions are formatted into output buffers, which are reused for every batch, too,
+    and written by one fwrite() per buffer, instead of one printf() per position.
+  - Optionally, pairs of a batch are spread across threads. Every thread gets a contiguous range of pairs,
+    with about the same number of bytes, and formats their rows into its own output buffer,
+    so concatenating the buffers in thread order gives the rows in input order.
+
+Input: pairs of rows, a pattern row followed by a text row. A row ends with '\n' (or "\r\n"),
+and it may contain spaces, so every byte but '\n' is a part of a pattern or a text.
+Output: one row per pair, in input order, with positions of occurences of the pattern in the text,
+like "hash_substring.c" prints them. An empty pattern has no occurences.
+
+Uses POSIX threads (link with -pthread). */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define MAX_THREADS 256
+#define READ_BUF_SIZE (1u << 20)                                // Input is read in blocks of this many bytes (1 MiB).
+#define MAX_BATCH_PAIRS 65536                                   // A batch ends after this many pairs,
+#define MAX_BATCH_BYTES (1u << 23)                              // or after this many bytes of rows (8 MiB), whichever comes first.
+#define MIN_BYTES_PER_THREAD (1u << 16)                         // Smaller batches are not split into that many ranges, because threads would cost more than they'd save.
+#define TRUE 1
+#define FALSE 0
+#define PRIME 1000000007u
+#define X 263                                                   // Multiplier; X != 1, so that anagrams of P don't collide with it.
+
+typedef unsigned long long ull;
+
+/* A growable array of bytes. It's the arena of a batch, and an output buffer. */
+typedef struct Buffer Buffer;
+
+struct Buffer {
+    char *data;
+    size_t len, cap;
+};
+
+/* One pair; pattern and text are in the arena, at these offsets, and not '\0'-terminated.
+Offsets, not pointers, because the arena may be moved by realloc() while the batch is read. */
+typedef struct Pair Pair;
+
+struct Pair {
+    size_t p, lenP;
+    size_t t, lenT;
+};
+
+typedef struct Reader Reader;
+
+struct Reader {
+    FILE *f;
+    char *buf;
+    size_t pos, len;
+};
+
+/* Work of one thread: pairs [begin, end) of the batch. */
+typedef struct Range Range;
+
+struct Range {
+    const char *arena;
+    const Pair *pairs;
+    size_t begin, end;
+    Buffer *out;
+};
+
+/* Makes room for n more bytes in b. Capacity only grows, so a reused buffer stops reallocating. */
+void reserve(Buffer *b, size_t n) {
+    if (b->len + n <= b->cap)
+        return;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + n)
+        cap <<= 1;
+    b->data = realloc(b->data, cap);
+    if (!b->data)                                               // if realloc fails
+        exit(-1);
+    b->cap = cap;
+}
+
+/* Appends the next row of input to the arena, without '\n' and a '\r' before it, and puts its length in len.
+Returns FALSE if there are no more rows. */
+int readRow(Reader *r, Buffer *arena, size_t *len) {
+    size_t start = arena->len;
+    int any = FALSE;
+    for (;;) {
+        if (r->pos == r->len) {
+            r->pos = 0;
+            r->len = fread(r->buf, 1, READ_BUF_SIZE, r->f);
+            if (!r->len)
+                break;
+        }
+        any = TRUE;
+        char *from = r->buf + r->pos;
+        char *nl = memchr(from, '\n', r->len - r->pos);
+        size_t n = nl ? (size_t)(nl - from) : r->len - r->pos;
+        reserve(arena, n);
+        memcpy(arena->data + arena->len, from, n);
+        arena->len += n;
+        r->pos += n;
+        if (nl) {
+            r->pos++;                                           // skips '\n'
+            break;
+        }
+    }
+    if (arena->len > start && arena->data[arena->len - 1] == '\r')
+        arena->len--;
+    *len = arena->len - start;
+    return any;
+}
+
+/* Fast formatter. Appends decimal v and a space to b. */
+void writeNumber(Buffer *b, ull v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    reserve(b, n + 1);
+    while (n)
+        b->data[b->len++] = digits[--n];
+    b->data[b->len++] = ' ';
+}
+
+/* Hash of the first n characters of s.
+h = s[0]*X**(n-1) + s[1]*X**(n-2) + ... + s[n-1], so that it can be rolled forward. */
+ull hashN(const unsigned char *s, size_t n) {
+    ull h = 0;
+
+    for (size_t i = 0; i < n; i++)
+        h = (h * X + s[i]) % PRIME;
+
+    return h;
+}
+
+/* Single-pass Rabin-Karp, as RabinKarpFused() in "hash_substring.c", with O(1) extra memory.
+Formats positions of occurences of P in T into out, as one row. */
+void RabinKarpRow(const char *T, size_t lenT, const char *P, size_t lenP, Buffer *out) {
+    if (lenP && lenP <= lenT) {
+        const unsigned char *U = (const unsigned char *)T;
+        ull y = 1;                                              // X**(lenP - 1) % PRIME: weight of the byte that leaves the window
+        for (size_t i = 1; i < lenP; i++)
+            y = y * X % PRIME;
+
+        ull pHash = hashN((const unsigned char *)P, lenP);
+        ull h = hashN(U, lenP);
+        size_t last = lenT - lenP;
+
+        for (size_t i = 0; ; i++) {
+            if (pHash == h && !memcmp(T + i, P, lenP))
+                writeNumber(out, i);
+            if (i == last)
+                break;
+            h = ((h + PRIME - y * U[i] % PRIME) * X + U[i + lenP]) % PRIME;
+        }
+    }
+    reserve(out, 1);
+    out->data[out->len++] = '\n';
+}
+
+void *searchRange(void *arg) {
+    Range *r = arg;
+    for (size_t k = r->begin; k < r->end; k++) {
+        const Pair *pair = &r->pairs[k];
+        RabinKarpRow(r->arena + pair->t, pair->lenT, r->arena + pair->p, pair->lenP, r->out);
+    }
+    return NULL;
+}
+
+/* Searches pairs [0, numPairs) of the batch, with up to numThreads threads,
+and writes their rows to stdout, in order. outs[] are the output buffers of the threads, reused by every batch. */
+void searchBatch(const char *arena, const Pair *pairs, size_t numPairs, size_t numBytes, int numThreads, Buffer *outs) {
+    while (numThreads > 1 && numBytes / numThreads < MIN_BYTES_PER_THREAD)
+        numThreads--;
+
+    Range ranges[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+
+    /* Cuts the batch into ranges with about numBytes / numThreads bytes each. */
+    size_t k = 0, bytes = 0;
+    for (int t = 0; t < numThreads; t++) {
+        Range *r = &ranges[t];
+        r->arena = arena;
+        r->pairs = pairs;
+        r->begin = k;
+        if (t == numThreads - 1)
+            k = numPairs;
+        else
+            while (k < numPairs && bytes < numBytes / numThreads * (t + 1)) {
+                bytes += pairs[k].lenP + pairs[k].lenT;
+                k++;
+            }
+        r->end = k;
+        r->out = &outs[t];
+        r->out->len = 0;
+        /* The first range is searched in this thread. */
+        if (t && pthread_create(&threads[t], NULL, searchRange, r))
+            exit(-1);
+    }
+    searchRange(&ranges[0]);
+
+    for (int t = 0; t < numThreads; t++) {
+        if (t)
+            pthread_join(threads[t], NULL);
+        fwrite(outs[t].data, 1, outs[t].len, stdout);
+    }
+}
+
+/* Wall-clock time in seconds. clock() would add up the CPU time of all threads. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* Usage: hash_substring_batch [-j THREADS] [FILE]
+Reads pairs from FILE, or from stdin if it's not given (or "-"). THREADS is 1 by default; 0 means all cores.
+Prints the number of pairs and the time to stderr. */
+int main(int argc, char *argv[]) {
+    int numThreads = 1;
+    int a = 1;
+    if (a + 1 < argc && !strcmp(argv[a], "-j")) {
+        numThreads = atoi(argv[a + 1]);
+        a += 2;
+    }
+    if (!numThreads)
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    numThreads = numThreads < 1 ? 1 : numThreads > MAX_THREADS ? MAX_THREADS : numThreads;
+
+    FILE *f = a < argc && strcmp(argv[a], "-") ? fopen(argv[a], "rb") : stdin;
+    if (!f) {
+        perror(argv[a]);
+        return 1;
+    }
+
+    Reader reader = { f, malloc(READ_BUF_SIZE), 0, 0 };
+    Pair *pairs = malloc(MAX_BATCH_PAIRS * sizeof(*pairs));
+    Buffer arena = { NULL, 0, 0 };
+    Buffer outs[MAX_THREADS] = { { NULL, 0, 0 } };
+    if (!reader.buf || !pairs)                                  // if malloc fails
+        exit(-1);
+
+    double t0 = now();
+    size_t numPairs = 0, total = 0;
+    int more = TRUE;
+    while (more) {
+        /* Reads a batch. */
+        arena.len = 0;
+        numPairs = 0;
+        while (numPairs < MAX_BATCH_PAIRS && arena.len < MAX_BATCH_BYTES) {
+            Pair *pair = &pairs[numPairs];
+            pair->p = arena.len;
+            if (!readRow(&reader, &arena, &pair->lenP)) {
+                more = FALSE;
+                break;
+            }
+            pair->t = arena.len;
+            readRow(&reader, &arena, &pair->lenT);              // A missing last text row is an empty text.
+            numPairs++;
+        }
+        searchBatch(arena.data, pairs, numPairs, arena.len, numThreads, outs);
+        total += numPairs;
+    }
+    fflush(stdout);
+    double t1 = now();
+    fprintf(stderr, "%zu pairs: %.3f s (%d threads)\n", total, t1 - t0, numThreads);
+
+    for (int t = 0; t < MAX_THREADS; t++)
+        free(outs[t].data);
+    free(arena.data);
+    free(pairs);
+    free(reader.buf);
+    if (f != stdin)
+        fclose(f);
+    return 0;
+}
+
+/* Test data:
+
+Input (three pairs; the last pattern and text contain spaces):
+aba
+abacaba
+aaaaa
+baaaaaaa
+a b
+a b a b
+Output:
+0 4
+1 2 3
+0 4
+Statistics (stderr):
+3 pairs: 0.000 s (1 threads)
+
+Input (empty pattern, and a pattern that is longer than the text):
+(empty row)
+abc
+abcd
+abc
+Output (two empty rows):
+
+
+*/
+
+#endif // HASH_SUBSTRING_BATCH
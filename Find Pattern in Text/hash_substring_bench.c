@@ -0,0 +1,214 @@
+//#define HASH_SUBSTRING_BENCH
+#ifdef HASH_SUBSTRING_BENCH
+
+/* Benchmark of the Rabin-Karp variants */
+
+/* "hash_substring.c", "hash_substring_a.c" and "hash_substring_alt.c" are all compiled into this
+compilation unit. Each one is included with its own guard defined, and with its functions, its x, and its main()
+renamed by macros, so that they get distinct names (hash_a(), RabinKarp_alt(), ...).
+Their macros are undefined after each inclusion, since they use the same names with different values.
+
+Then, as their header comments suggest, all matchers (RabinKarp() and RabinKarpFused() of every variant)
+are run in a large loop, with time measured inside of the compilation unit, and with results only counted
+(SINK_COUNT), not printed. Texts are generated, with varying size, alphabet and pattern length.
+Every measurement is preceded by a warmup run, and the best of REPS runs is reported,
+in GB/s and ns/byte, together with the number of spurious hits: windows whose hash is equal to
+the pattern hash, but which are not occurences of the pattern. Every matcher verifies a hash hit with strncmp(),
+and only a hash hit, so strncmp() is replaced by a counting wrapper in the included files: hits are counted
+in the timed run itself, with the hash of the matcher that is timed (and with its x, which the alt variant
+chooses randomly in every run). */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+/* All standard headers are included before the renaming macros are defined, so that they aren't affected by them. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+/* Number of calls of strncmp() in the included files, i.e., of hash hits, since it was last reset. */
+size_t numHashHits = 0;
+
+int countingStrncmp(const char *a, const char *b, size_t n) {
+    numHashHits++;
+    return strncmp(a, b, n);
+}
+
+#define strncmp countingStrncmp
+
+#define x x_orig
+#define hash hash_orig
+#define hashN hashN_orig
+#define precomputeHashes precomputeHashes_orig
+#define RabinKarp RabinKarp_orig
+#define RabinKarpFused RabinKarpFused_orig
+#define RabinKarpStream RabinKarpStream_orig
+#define main main_orig
+#include "hash_substring.c"
+#undef x
+#undef hash
+#undef hashN
+#undef precomputeHashes
+#undef RabinKarp
+#undef RabinKarpFused
+#undef RabinKarpStream
+#undef main
+#undef MAX_NUM_ITEMS
+#undef MAX_P_OCCURENCES_LEN
+#undef CHUNK_SIZE
+#undef PRIME
+#undef MR
+#undef NR
+
+#define HASH_SUBSTRING_A
+#define x x_a
+#define hash hash_a
+#define hashN hashN_a
+#define precomputeHashes precomputeHashes_a
+#define RabinKarp RabinKarp_a
+#define RabinKarpFused RabinKarpFused_a
+#define main main_a
+#include "hash_substring_a.c"
+#undef x
+#undef hash
+#undef hashN
+#undef precomputeHashes
+#undef RabinKarp
+#undef RabinKarpFused
+#undef main
+#undef MAX_NUM_ITEMS
+#undef MAX_P_OCCURENCES_LEN
+#undef PRIME
+#undef MR
+#undef NR
+
+#define HASH_SUBSTRING_ALT
+#define x x_alt
+#define hash hash_alt
+#define hashN hashN_alt
+#define precomputeHashes precomputeHashes_alt
+#define RabinKarp RabinKarp_alt
+#define RabinKarpFused RabinKarpFused_alt
+#define main main_alt
+#include "hash_substring_alt.c"
+#undef x
+#undef hash
+#undef hashN
+#undef precomputeHashes
+#undef RabinKarp
+#undef RabinKarpFused
+#undef main
+#undef MAX_NUM_ITEMS
+#undef MAX_P_OCCURENCES_LEN
+#undef PRIME
+#undef POWER
+#undef M
+#undef Q
+#undef R
+#undef strncmp
+
+#define REPS 5                                                  // Number of measured runs of every matcher, after one warmup run.
+#define MAX_SIZE_MIB 16                                         // Default size of the largest text, in MiB.
+
+typedef struct Variant Variant;
+
+/* One matcher. */
+struct Variant {
+    const char *name;
+    void (*search)(char *T, char *P, MatchSink *sink);
+};
+
+static const Variant variants[] = {
+    { "hash_substring",           RabinKarp_orig },
+    { "hash_substring fused",     RabinKarpFused_orig },
+    { "hash_substring_a",         RabinKarp_a },
+    { "hash_substring_a fused",   RabinKarpFused_a },
+    { "hash_substring_alt",       RabinKarp_alt },
+    { "hash_substring_alt fused", RabinKarpFused_alt },
+};
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Fills T with n random characters from an alphabet of size sigma, starting at 'a' (or at '!', for sigma > 26),
+and terminates it. Only printable ASCII is used, because hash() and precomputeHashes() of the first two variants
+work on signed chars. */
+void generateText(char *T, size_t n, int sigma) {
+    char first = sigma > 26 ? '!' : 'a';
+    for (size_t i = 0; i < n; i++)
+        T[i] = (char)(first + rand() % sigma);
+    T[n] = '\0';
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* Texts of 1 MiB and of the largest size are generated.
+Optional arguments: size of the largest text in MiB (MAX_SIZE_MIB by default), and number of runs (REPS by default). */
+int main(int argc, char *argv[]) {
+    static const int sigmas[] = { 2, 4, 26, 94 };
+    static const size_t patternLens[] = { 4, 16, 64 };
+    size_t maxSize = (size_t)(argc > 1 ? atoi(argv[1]) : MAX_SIZE_MIB) << 20;
+    int reps = argc > 2 ? atoi(argv[2]) : REPS;
+    const int numVariants = sizeof(variants) / sizeof(*variants);
+
+    srand(12345);                                               // The same texts in every run of the benchmark.
+    char *T = malloc(maxSize + 1);
+    char P[128];
+    if (!T)                                                     // if malloc fails
+        exit(-1);
+
+    printf("%-26s %10s %5s %4s %8s %8s %10s %10s\n", "variant", "size", "sigma", "m", "GB/s", "ns/byte", "matches", "spurious");
+
+    for (size_t size = 1 << 20; size <= maxSize; size = size < maxSize ? maxSize : size + 1) {
+        for (size_t si = 0; si < sizeof(sigmas) / sizeof(*sigmas); si++) {
+            generateText(T, size, sigmas[si]);
+            for (size_t pi = 0; pi < sizeof(patternLens) / sizeof(*patternLens); pi++) {
+                size_t lenP = patternLens[pi];
+                memcpy(P, T + (size_t)rand() % (size - lenP), lenP);   // so that there is at least one occurence
+                P[lenP] = '\0';
+
+                for (int v = 0; v < numVariants; v++) {
+                    MatchSink sink = makeSink(SINK_COUNT, 0);
+                    variants[v].search(T, P, &sink);            // warmup
+                    double best = 1e30;
+                    size_t hits = 0;
+                    for (int r = 0; r < reps; r++) {
+                        sink = makeSink(SINK_COUNT, 0);
+                        numHashHits = 0;
+                        double t0 = now();
+                        variants[v].search(T, P, &sink);
+                        double diff = now() - t0;
+                        best = diff < best ? diff : best;
+                        hits = numHashHits;
+                    }
+                    size_t spurious = hits - sink.count;        // of the last timed run
+                    printf("%-26s %10zu %5d %4zu %8.3f %8.3f %10zu %10zu\n", variants[v].name, size, sigmas[si], lenP,
+                           size / best * 1e-9, best * 1e9 / size, sink.count, spurious);
+                }
+            }
+        }
+    }
+
+    free(T);
+    return 0;
+}
+
+/* Usage:
+
+hash_substring_bench 16 5
+Output:
+variant                          size sigma    m     GB/s  ns/byte    matches   spurious
+hash_substring                1048576     2    4    ...
+...
+*/
+
+#endif // HASH_SUBSTRING_BENCH
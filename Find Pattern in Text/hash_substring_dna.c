@@ -0,0 +1,542 @@
+//#define HASH_SUBSTRING_DNA
+#ifdef HASH_SUBSTRING_DNA
+
+/* Find pattern in DNA, and count k-mers, on 2-bit packed sequences */
+
+/* A sequence of A, C, G and T is packed at 2 bits per base, 32 bases per 64-bit word
+(base i is in bits 2*(i % 32) of word i / 32), so it takes 4 times less memory than one char per base.
+
+The rolling hash is updated directly from the packed bits: with X == 4 and modulo 2**64,
+    h = h*X + base - X**L*out
+is just a shift of the window by 2 bits, so the hash of a window of up to 32 bases is the window itself.
+For patterns of up to 32 bases that means there are no collisions, and hash hits need no verification.
+For longer patterns, the hash is taken over the last 32 bases of the window, and hits are verified
+by comparing the rest of the pattern with the text 32 bases (one word) at a time, and not base by base.
+
+k-mers (k <= 32) are counted in their canonical form: the lesser of the k-mer and its reverse complement,
+since a read can come from either strand. Both are rolled from the packed stream:
+    forward = (forward << 2 | base) & mask, reverse = reverse >> 2 | (3 - base) << 2*(k - 1)
+and the counts go into an open-addressing hash table with linear probing. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#define PREFETCH(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#else
+#define PREFETCH(p) __builtin_prefetch(p)
+#endif // _MSC_VER
+
+#define MAX_NUM_ITEMS 500001                                    // Max length of P and T in stdin mode. +1 for '\0'.
+#define READ_CHUNK (1u << 20)
+#define TOP 10                                                  // Default number of most frequent k-mers to print
+#define GOLDEN 0x9e3779b97f4a7c15llu                            // 2**64 / golden ratio; spreads k-mers over the slots of the table
+#define MAX_INITIAL_BITS 27                                     // The table is sized for the k-mers up front, but with at most 2**MAX_INITIAL_BITS slots.
+#define PREFETCH_DISTANCE 16                                    // Number of k-mers whose slots are being fetched while the earlier ones are counted; a power of two
+
+typedef unsigned long long ull;
+
+static const char BASES[] = "ACGT";
+
+/* PACKING CODE */
+
+typedef struct Sequence Sequence;
+
+struct Sequence {
+    ull *w;                                                     // len / 32 + 2 words; the last one is padding, so that get64() can always read w[q + 1]
+    size_t len;                                                 // number of bases
+    size_t cap;                                                 // number of words
+};
+
+/* 2-bit code of a base, or -1 if it isn't one of ACGT (in either case). */
+int code(int c) {
+    switch (c) {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': return 3;
+    default: return -1;
+    }
+}
+
+void appendBase(Sequence *s, int b) {
+    if (s->len / 32 + 2 > s->cap) {
+        size_t old = s->cap;
+        s->cap = s->cap ? s->cap << 1 : 64;
+        s->w = realloc(s->w, s->cap * sizeof(*s->w));
+        if (!s->w)                                              // if realloc fails
+            exit(-1);
+        memset(s->w + old, 0, (s->cap - old) * sizeof(*s->w));
+    }
+    s->w[s->len / 32] |= (ull)b << (2 * (s->len % 32));
+    s->len++;
+}
+
+/* Packs a string of ACGT. Returns FALSE if there's another character in it. */
+int packString(Sequence *s, const char *str) {
+    s->w = NULL;
+    s->len = s->cap = 0;
+    appendBase(s, 0);                                           // allocates at least two words, even for an empty string
+    s->len = 0;
+    s->w[0] = 0;
+    for ( ; *str; str++) {
+        int b = code(*str);
+        if (b < 0)
+            return 0;
+        appendBase(s, b);
+    }
+    return 1;
+}
+
+/* Packs a FASTA file (rows that start with '>' are headers, and they're skipped), or a plain sequence.
+White space is skipped. Returns FALSE if there's a character other than ACGT in a sequence. */
+int packFile(Sequence *s, FILE *f) {
+    static char buf[READ_CHUNK];
+    size_t n;
+    int inHeader = 0, atRowStart = 1;
+    packString(s, "");
+    while ((n = fread(buf, 1, READ_CHUNK, f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            char c = buf[i];
+            if (atRowStart && c == '>')
+                inHeader = 1;
+            atRowStart = c == '\n';
+            if (inHeader) {
+                inHeader = c != '\n';
+                continue;
+            }
+            if (c == '\n' || c == '\r' || c == ' ' || c == '\t')
+                continue;
+            int b = code(c);
+            if (b < 0)
+                return 0;
+            appendBase(s, b);
+        }
+    }
+    return 1;
+}
+
+/* 32 bases starting at pos, in one word (bases past the end are 0). */
+ull get64(const Sequence *s, size_t pos) {
+    size_t q = pos / 32;
+    int r = 2 * (pos % 32);
+    return r ? s->w[q] >> r | s->w[q + 1] << (64 - r) : s->w[q];
+}
+
+/* The lowest 2*n bits. */
+ull lowMask(size_t n) {
+    return n >= 32 ? ~0llu : ((ull)1 << (2 * n)) - 1;
+}
+
+/* Are T[start..start+n) and P[from..from+n) equal? Compares one word (32 bases) at a time. */
+int equalBases(const Sequence *T, size_t start, const Sequence *P, size_t from, size_t n) {
+    size_t j;
+    for (j = 0; j + 32 <= n; j += 32) {
+        if (get64(T, start + j) != get64(P, from + j))
+            return 0;
+    }
+    return j == n || !((get64(T, start + j) ^ get64(P, from + j)) & lowMask(n - j));
+}
+
+
+/* SEARCH CODE */
+
+/* Positions of occurences; a growable array. */
+typedef struct Matches Matches;
+
+struct Matches {
+    size_t *pos;
+    size_t len, cap;
+};
+
+void addMatch(Matches *m, size_t pos) {
+    if (m->len == m->cap) {
+        m->cap = m->cap ? m->cap << 1 : 16;
+        m->pos = realloc(m->pos, m->cap * sizeof(*m->pos));
+        if (!m->pos)                                            // if realloc fails
+            exit(-1);
+    }
+    m->pos[m->len++] = pos;
+}
+
+/* Reports a match of the window that ends at base + b, if its hash is pHash, and the rest of P is equal.
+The window is taken from two words at once, lo and hi, so that windows don't depend on each other,
+and the CPU can check several of them in parallel. */
+#define CHECK(b) \
+    if ((((lo >> (2 * (b) + 2)) | (hi << (62 - 2 * (b)))) >> shift) == pHash) { \
+        size_t start = base + (b) + 1 - lenP; \
+        if (lenP <= 32 || equalBases(T, start, P, 0, lenP - 32)) \
+            addMatch(m, start); \
+    }
+
+/* Rabin-Karp on packed sequences. The hash of the window is its last L == min(lenP, 32) bases,
+kept in the top 2*L bits of h, which moves by 2 bits per base; the text is read one word at a time.
+In words in which every window is complete (almost all of them), the hashes of all 32 windows
+are taken directly from the word and the one before it, instead. */
+void RabinKarpPacked(const Sequence *T, const Sequence *P, Matches *m) {
+    size_t lenP = P->len;
+    if (!lenP || lenP > T->len)
+        return;
+
+    size_t L = lenP < 32 ? lenP : 32;
+    int shift = (int)(64 - 2 * L);
+    ull pHash = get64(P, lenP - L) & lowMask(L);
+    ull h = 0;
+
+    for (size_t q = 0; q * 32 < T->len; q++) {
+        size_t base = q * 32;                                   // position of the first base of the word
+        size_t end = T->len - base < 32 ? T->len - base : 32;
+        if (q && base + 1 >= lenP && end == 32) {
+            ull lo = T->w[q - 1], hi = T->w[q];
+            for (int b = 0; b < 28; b += 4) {
+                CHECK(b)
+                CHECK(b + 1)
+                CHECK(b + 2)
+                CHECK(b + 3)
+            }
+            CHECK(28)
+            CHECK(29)
+            CHECK(30)
+            h = hi;                                             // the window that ends at base + 31 is the whole word
+            if (h >> shift == pHash) {
+                size_t start = base + 32 - lenP;
+                if (lenP <= 32 || equalBases(T, start, P, 0, lenP - 32))
+                    addMatch(m, start);
+            }
+        }
+        else {
+            ull w = T->w[q];
+            for (size_t b = 0; b < end; b++, w >>= 2) {
+                h = h >> 2 | w << 62;                           // the new base goes into the top 2 bits
+                if (base + b + 1 >= lenP && h >> shift == pHash) {
+                    size_t start = base + b + 1 - lenP;         // the window ends at base + b
+                    if (lenP <= 32 || equalBases(T, start, P, 0, lenP - 32))
+                        addMatch(m, start);
+                }
+            }
+        }
+    }
+}
+
+/* The same search on one char per base, with a byte-by-byte rolling hash and memcmp(); for comparison. */
+void RabinKarpBytes(const char *T, size_t lenT, const char *P, size_t lenP, Matches *m) {
+    if (!lenP || lenP > lenT)
+        return;
+    ull pHash = 0, h = 0, y = 1;                                // y == 31**lenP
+    for (size_t i = 0; i < lenP; i++) {
+        pHash = pHash * 31 + (unsigned char)P[i];
+        h = h * 31 + (unsigned char)T[i];
+        y *= 31;
+    }
+    for (size_t i = 0; ; i++) {
+        if (h == pHash && !memcmp(T + i, P, lenP))
+            addMatch(m, i);
+        if (i + lenP == lenT)
+            break;
+        h = h * 31 + (unsigned char)T[i + lenP] - y * (unsigned char)T[i];
+    }
+}
+
+
+/* K-MER COUNTING CODE */
+
+typedef struct Slot Slot;
+
+struct Slot {
+    ull kmer;
+    ull count;                                                  // 0 if the slot is empty
+};
+
+typedef struct KmerTable KmerTable;
+
+struct KmerTable {
+    Slot *slots;
+    int bits;                                                   // number of slots == 2**bits
+    size_t len;                                                 // number of distinct k-mers
+};
+
+/* Makes an empty table for (about) numKmers distinct k-mers, so that it rarely has to grow,
+since every growth moves all k-mers, with a cache miss for each one. */
+void initTable(KmerTable *t, size_t numKmers) {
+    for (t->bits = 16; t->bits < MAX_INITIAL_BITS && ((size_t)1 << t->bits) < 2 * numKmers; t->bits++)
+        ;
+    t->slots = calloc((size_t)1 << t->bits, sizeof(*t->slots));
+    t->len = 0;
+    if (!t->slots)                                              // if calloc fails
+        exit(-1);
+}
+
+void growTable(KmerTable *t) {
+    Slot *old = t->slots;
+    size_t oldSize = (size_t)1 << t->bits;
+    t->bits++;
+    t->slots = calloc((size_t)1 << t->bits, sizeof(*t->slots));
+    if (!t->slots)                                              // if calloc fails
+        exit(-1);
+    size_t mask = ((size_t)1 << t->bits) - 1;
+    for (size_t i = 0; i < oldSize; i++) {
+        if (old[i].count) {
+            size_t j = (size_t)((old[i].kmer * GOLDEN) >> (64 - t->bits));
+            while (t->slots[j].count)
+                j = (j + 1) & mask;
+            t->slots[j] = old[i];
+        }
+    }
+    free(old);
+}
+
+/* Load factor is kept at most 1/2. */
+void countKmer(KmerTable *t, ull kmer) {
+    size_t mask = ((size_t)1 << t->bits) - 1;
+    size_t j = (size_t)((kmer * GOLDEN) >> (64 - t->bits));
+    for ( ; t->slots[j].count; j = (j + 1) & mask) {
+        if (t->slots[j].kmer == kmer) {
+            t->slots[j].count++;
+            return;
+        }
+    }
+    if (2 * (t->len + 1) > mask + 1) {
+        growTable(t);
+        countKmer(t, kmer);
+        return;
+    }
+    t->slots[j].kmer = kmer;
+    t->slots[j].count = 1;
+    t->len++;
+}
+
+/* Counts the canonical k-mers of s, for 1 <= k <= 32.
+Once the table is larger than the cache, almost every k-mer is a cache miss, so the slot of every k-mer
+is prefetched, and it's counted PREFETCH_DISTANCE k-mers later, when the slot is (hopefully) already there. */
+void countKmers(const Sequence *s, int k, KmerTable *t) {
+    ull mask = lowMask((size_t)k);
+    ull forward = 0, reverse = 0;
+    int top = 2 * (k - 1);
+    ull pending[PREFETCH_DISTANCE];
+    size_t numPending = 0;
+
+    for (size_t q = 0; q * 32 < s->len; q++) {
+        ull w = s->w[q];
+        size_t end = s->len - q * 32 < 32 ? s->len - q * 32 : 32;
+        for (size_t b = 0; b < end; b++, w >>= 2) {
+            ull base = w & 3;
+            forward = (forward << 2 | base) & mask;
+            reverse = reverse >> 2 | (3 - base) << top;
+            if (q * 32 + b + 1 >= (size_t)k) {
+                ull kmer = forward < reverse ? forward : reverse;
+                PREFETCH(&t->slots[(kmer * GOLDEN) >> (64 - t->bits)]);
+                size_t i = numPending++ & (PREFETCH_DISTANCE - 1);
+                if (numPending > PREFETCH_DISTANCE)
+                    countKmer(t, pending[i]);
+                pending[i] = kmer;
+            }
+        }
+    }
+    for (size_t i = 0; i < numPending && i < PREFETCH_DISTANCE; i++)
+        countKmer(t, pending[i]);
+}
+
+/* Is slot u more frequent than v? Equal counts are ordered by k-mers. */
+int moreFrequent(const Slot *u, const Slot *v) {
+    return u->count != v->count ? u->count > v->count : u->kmer < v->kmer;
+}
+
+int compareByCount(const void *a, const void *b) {
+    return moreFrequent(a, b) ? -1 : moreFrequent(b, a);
+}
+
+/* Restores the min-heap (the least frequent slot at the root) below i. */
+void siftDown(Slot *heap, size_t n, size_t i) {
+    for (;;) {
+        size_t least = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && moreFrequent(&heap[least], &heap[l]))
+            least = l;
+        if (r < n && moreFrequent(&heap[least], &heap[r]))
+            least = r;
+        if (least == i)
+            return;
+        Slot tmp = heap[i];
+        heap[i] = heap[least];
+        heap[least] = tmp;
+        i = least;
+    }
+}
+
+/* Prints the number of distinct canonical k-mers, and the top most frequent ones with their counts.
+The top ones are selected with a min-heap of size top, in O(n log top), without sorting all of them. */
+void printTopKmers(const KmerTable *t, int k, size_t top) {
+    if (top > t->len)
+        top = t->len;
+    Slot *heap = malloc((top ? top : 1) * sizeof(*heap));
+    if (!heap)                                                  // if malloc fails
+        exit(-1);
+    size_t n = 0;
+    for (size_t i = 0; top && i < ((size_t)1 << t->bits); i++) {
+        const Slot *slot = &t->slots[i];
+        if (!slot->count)
+            continue;
+        if (n < top) {
+            heap[n++] = *slot;
+            if (n == top)
+                for (size_t j = top / 2; j-- > 0; )
+                    siftDown(heap, n, j);
+        }
+        else if (moreFrequent(slot, &heap[0])) {
+            heap[0] = *slot;
+            siftDown(heap, n, 0);
+        }
+    }
+    qsort(heap, n, sizeof(*heap), compareByCount);
+
+    char kmer[33];
+    printf("%zu\n", t->len);
+    for (size_t i = 0; i < n; i++) {
+        for (int j = 0; j < k; j++)
+            kmer[j] = BASES[(heap[i].kmer >> (2 * (k - 1 - j))) & 3];
+        kmer[k] = '\0';
+        printf("%s %llu\n", kmer, heap[i].count);
+    }
+    free(heap);
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void printMatches(const Matches *m) {
+    for (size_t i = 0; i < m->len; i++)
+        printf("%zu ", m->pos[i]);
+    printf("\n");
+}
+
+FILE *openFile(const char *name) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    return f;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* With no arguments, reads pattern and text from stdin, as "hash_substring.c" does.
+With arguments PATTERN FILE, searches the file (FASTA or plain).
+With arguments PATTERN FILE bench, times the packed search and the byte search, without printing positions.
+With arguments -k K FILE [TOP], counts canonical k-mers of the file, and prints the TOP most frequent ones. */
+int main(int argc, char *argv[]) {
+    Sequence T, P;
+    Matches m = { NULL, 0, 0 };
+
+    if (argc > 3 && !strcmp(argv[1], "-k")) {
+        int k = atoi(argv[2]);
+        if (k < 1 || k > 32) {
+            fprintf(stderr, "k must be in [1, 32]\n");
+            return 1;
+        }
+        FILE *f = openFile(argv[3]);
+        if (!packFile(&T, f)) {
+            fprintf(stderr, "%s: only A, C, G and T are supported\n", argv[3]);
+            return 1;
+        }
+        fclose(f);
+        /* There are at most 4**k distinct k-mers. */
+        size_t numKmers = T.len >= (size_t)k ? T.len - k + 1 : 0;
+        KmerTable t;
+        initTable(&t, k < 16 && numKmers > ((size_t)1 << (2 * k)) ? (size_t)1 << (2 * k) : numKmers);
+        countKmers(&T, k, &t);
+        printTopKmers(&t, k, argc > 4 ? (size_t)atol(argv[4]) : TOP);
+        free(t.slots);
+        free(T.w);
+        return 0;
+    }
+
+    if (argc < 3) {
+        static char pattern[MAX_NUM_ITEMS], text[MAX_NUM_ITEMS];
+        scanf("%500000s", pattern);
+        scanf("%500000s", text);
+        if (!packString(&P, pattern) || !packString(&T, text)) {
+            fprintf(stderr, "only A, C, G and T are supported\n");
+            return 1;
+        }
+        RabinKarpPacked(&T, &P, &m);
+        printMatches(&m);
+    }
+    else {
+        FILE *f = openFile(argv[2]);
+        if (!packString(&P, argv[1]) || !packFile(&T, f)) {
+            fprintf(stderr, "only A, C, G and T are supported\n");
+            return 1;
+        }
+        fclose(f);
+
+        if (argc > 3 && !strcmp(argv[3], "bench")) {
+            /* The byte search gets the same sequence, unpacked, so that both find the same matches. */
+            char *bytes = malloc(T.len + 1);
+            if (!bytes)                                         // if malloc fails
+                exit(-1);
+            for (size_t i = 0; i < T.len; i++)
+                bytes[i] = BASES[(T.w[i / 32] >> (2 * (i % 32))) & 3];
+            bytes[T.len] = '\0';
+
+            double t0 = now();
+            RabinKarpPacked(&T, &P, &m);
+            double t1 = now();
+            printf("packed: %.3f s, %.3f Gbases/s, %zu matches, %zu bytes of text\n",
+                   t1 - t0, T.len / (t1 - t0) * 1e-9, m.len, T.len / 4);
+            m.len = 0;
+            t0 = now();
+            RabinKarpBytes(bytes, T.len, argv[1], P.len, &m);
+            t1 = now();
+            printf("bytes : %.3f s, %.3f Gbases/s, %zu matches, %zu bytes of text\n",
+                   t1 - t0, T.len / (t1 - t0) * 1e-9, m.len, T.len);
+            free(bytes);
+        }
+        else {
+            RabinKarpPacked(&T, &P, &m);
+            printMatches(&m);
+        }
+    }
+
+    free(m.pos);
+    free(P.w);
+    free(T.w);
+    return 0;
+}
+
+/* Test data:
+
+We should input two strings of ACGT, in two rows, and the result is
+positions of occurences of the first string in the second one.
+
+Input:
+ACA
+ACACGTACAT
+Output:
+0 6
+
+Input (a pattern longer than 32 bases):
+ACGTACGTACGTACGTACGTACGTACGTACGTA
+TACGTACGTACGTACGTACGTACGTACGTACGTACGTA
+Output:
+1 5
+
+k-mer counting (printf ">seq\nACGTT\nAACGT\n" > s.fa; hash_substring_dna -k 3 s.fa):
+Output is the number of distinct canonical k-mers, and the most frequent ones with their counts.
+The sequence is ACGTTAACGT; CGT is counted as ACG, GTT as AAC, and TTA as TAA.
+3
+ACG 4
+AAC 2
+TAA 2
+*/
+
+#endif // HASH_SUBSTRING_DNA
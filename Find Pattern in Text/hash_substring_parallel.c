@@ -0,0 +1,266 @@
+//#define HASH_SUBSTRING_PARALLEL
+#ifdef HASH_SUBSTRING_PARALLEL
+
+/* Find pattern in text, in parallel */
+
+/* T is split into one chunk per thread. Each chunk is extended by lenP - 1 bytes
+into the next one, so that every window belongs to exactly one chunk, and no match is lost
+at a chunk boundary. Every thread rolls its own window hash, starting from the beginning of its chunk,
+using y == X**(lenP - 1) % PRIME, which is computed once and shared by all threads.
+Every thread appends its matches to its own list, and since the chunks are in order,
+concatenating the lists in thread order gives globally sorted positions.
+
+Uses POSIX threads (link with -pthread). */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define MAX_NUM_ITEMS 500001                                    // Max length of P and T in stdin mode. +1 for '\0'.
+#define MAX_THREADS 256
+#define MIN_CHUNK_SIZE (1u << 16)                               // Smaller texts are not split into that many chunks, because threads would cost more than they'd save.
+#define PRIME 1000000007u
+#define X 263                                                   // Multiplier; X != 1, so that anagrams of P don't collide with it.
+
+typedef unsigned long long ull;
+
+/* Positions of occurences; a growable array. */
+typedef struct Matches Matches;
+
+struct Matches {
+    size_t *pos;
+    size_t len, cap;
+};
+
+/* Work of one thread: windows that start in [begin, end). */
+typedef struct Chunk Chunk;
+
+struct Chunk {
+    const char *T, *P;
+    size_t lenP;
+    size_t begin, end;
+    ull y;                                                      // X**(lenP - 1) % PRIME: weight of the character that leaves the window
+    ull pHash;
+    Matches matches;
+};
+
+/* Hash of the first n characters of s.
+h = s[0]*X**(n-1) + s[1]*X**(n-2) + ... + s[n-1], so that it can be rolled forward. */
+ull hashN(const char *s, size_t n) {
+    const unsigned char *u = (const unsigned char *)s;
+    ull h = 0;
+
+    for (size_t i = 0; i < n; i++)
+        h = (h * X + u[i]) % PRIME;
+
+    return h;
+}
+
+/* X**n % PRIME. */
+ull power(size_t n) {
+    ull y = 1;
+    for (size_t k = 0; k < n; k++)
+        y = (y * X) % PRIME;
+    return y;
+}
+
+void addMatch(Matches *m, size_t pos) {
+    if (m->len == m->cap) {
+        m->cap = m->cap ? m->cap << 1 : 16;
+        m->pos = realloc(m->pos, m->cap * sizeof(*m->pos));
+        if (!m->pos)                                            // if realloc fails
+            exit(-1);
+    }
+    m->pos[m->len++] = pos;
+}
+
+/* Thread function. Searches the windows of one chunk. */
+void *searchChunk(void *arg) {
+    Chunk *c = arg;
+    const unsigned char *U = (const unsigned char *)c->T;
+    size_t lenP = c->lenP;
+    ull y = c->y;
+    ull h = hashN(c->T + c->begin, lenP);
+
+    for (size_t i = c->begin; ; i++) {
+        if (c->pHash == h && !memcmp(c->T + i, c->P, lenP))
+            addMatch(&c->matches, i);
+        if (i + 1 == c->end)
+            break;
+        h = ((h + PRIME - (U[i] * y) % PRIME) * X + U[i + lenP]) % PRIME;
+    }
+    return NULL;
+}
+
+/* Finds all occurences of P in T, using up to numThreads threads.
+Returns positions in increasing order, in a single array, whose length goes to numMatches.
+The number of threads that were actually used goes to numThreadsUsed, if it's not NULL:
+it's less than numThreads when the chunks would be smaller than MIN_CHUNK_SIZE windows. */
+size_t *RabinKarpParallel(const char *T, size_t lenT, const char *P, size_t lenP, int numThreads, size_t *numMatches,
+                          int *numThreadsUsed) {
+    *numMatches = 0;
+    if (numThreadsUsed)
+        *numThreadsUsed = 1;
+    if (!lenP || lenP > lenT)
+        return NULL;
+
+    size_t numWindows = lenT - lenP + 1;
+    if (numThreads > MAX_THREADS)
+        numThreads = MAX_THREADS;
+    while (numThreads > 1 && numWindows / numThreads < MIN_CHUNK_SIZE)
+        numThreads--;
+    if (numThreadsUsed)
+        *numThreadsUsed = numThreads;
+
+    ull y = power(lenP - 1);
+    ull pHash = hashN(P, lenP);
+    Chunk chunks[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+
+    for (int t = 0; t < numThreads; t++) {
+        Chunk *c = &chunks[t];
+        c->T = T;
+        c->P = P;
+        c->lenP = lenP;
+        c->begin = numWindows / numThreads * t;
+        c->end = t == numThreads - 1 ? numWindows : numWindows / numThreads * (t + 1);
+        c->y = y;
+        c->pHash = pHash;
+        c->matches.pos = NULL;
+        c->matches.len = c->matches.cap = 0;
+        /* The first chunk is searched in this thread. */
+        if (t && pthread_create(&threads[t], NULL, searchChunk, c))
+            exit(-1);
+    }
+    searchChunk(&chunks[0]);
+
+    size_t total = chunks[0].matches.len;
+    for (int t = 1; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+        total += chunks[t].matches.len;
+    }
+
+    /* Merge: chunks don't overlap in window starts, and they're in order, so this is just concatenation. */
+    size_t *result = malloc((total ? total : 1) * sizeof(*result));
+    if (!result)
+        exit(-1);
+    for (int t = 0; t < numThreads; t++) {
+        memcpy(result + *numMatches, chunks[t].matches.pos, chunks[t].matches.len * sizeof(*result));
+        *numMatches += chunks[t].matches.len;
+        free(chunks[t].matches.pos);
+    }
+
+    return result;
+}
+
+/* Wall-clock time in seconds. clock() would add up the CPU time of all threads. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Reads the whole file into memory. */
+char *readFile(const char *name, size_t *len) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(*len + 1);
+    if (!buf || fread(buf, 1, *len, f) != *len)
+        exit(-1);
+    buf[*len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* With no arguments, reads pattern and text from stdin, as "hash_substring.c" does, and uses all cores.
+With arguments PATTERN FILE [THREADS], searches the file with THREADS threads (all cores by default).
+With THREADS == 0, doesn't print positions, but measures scaling instead:
+it runs the search with 1, 2, 4, ... threads, up to the number of cores, and prints the time of each run. */
+int main(int argc, char *argv[]) {
+    int numCores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    numCores = numCores > 0 ? numCores : 1;
+    size_t numMatches, *matches;
+
+    if (argc < 3) {
+        static char pattern[MAX_NUM_ITEMS], text[MAX_NUM_ITEMS];
+        scanf("%500000s", pattern);
+        scanf("%500000s", text);
+        matches = RabinKarpParallel(text, strlen(text), pattern, strlen(pattern), numCores, &numMatches, NULL);
+        for (size_t i = 0; i < numMatches; i++)
+            printf("%zu ", matches[i]);
+        printf("\n");
+        free(matches);
+        return 0;
+    }
+
+    size_t lenT;
+    char *T = readFile(argv[2], &lenT);
+    int numThreads = argc > 3 ? atoi(argv[3]) : numCores;
+
+    if (numThreads > 0) {
+        matches = RabinKarpParallel(T, lenT, argv[1], strlen(argv[1]), numThreads, &numMatches, NULL);
+        for (size_t i = 0; i < numMatches; i++)
+            printf("%zu ", matches[i]);
+        printf("\n");
+        free(matches);
+    }
+    else {
+        for (int t = 1; ; t = t << 1 < numCores ? t << 1 : numCores) {
+            int used;
+            double t0 = now();
+            matches = RabinKarpParallel(T, lenT, argv[1], strlen(argv[1]), t, &numMatches, &used);
+            double diff = now() - t0;
+            printf("%3d threads: %.3f s, %.3f GB/s, %zu matches", t, diff, lenT / diff * 1e-9, numMatches);
+            if (used != t)
+                printf(" (%d threads used; the text is too short for more)", used);
+            printf("\n");
+            free(matches);
+            if (t == numCores)
+                break;
+        }
+    }
+
+    free(T);
+    return 0;
+}
+
+/* Test data:
+
+We should input two strings, in two rows, and the result is
+positions of occurences of the first string in the second one.
+
+Input:
+aba
+abacaba
+Output:
+0 4
+
+Input:
+aaaaa
+baaaaaaa
+Output:
+1 2 3
+
+Scaling:
+hash_substring_parallel Lorem big.txt 0
+Output:
+  1 threads: ... s, ... GB/s, ... matches
+  2 threads: ...
+*/
+
+#endif // HASH_SUBSTRING_PARALLEL
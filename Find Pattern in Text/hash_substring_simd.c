@@ -0,0 +1,310 @@
+//#define HASH_SUBSTRING_SIMD
+#ifdef HASH_SUBSTRING_SIMD
+
+/* Find pattern in text, with SIMD */
+
+/* Window hashes are computed for 8 (AVX2) or 16 (AVX-512) consecutive positions at once,
+and compared to the pattern hash with one vector compare. The resulting bit mask
+(movemask) tells which positions are candidates, and only those go to byte verification.
+
+A rolling hash can't be vectorized directly, because every window hash depends on the previous one.
+That's why the window hashes are computed from prefix hashes and a power, instead:
+    Q[0] = 0, Q[k + 1] = Q[k]*X + T[k]
+    hash(T[j..j+lenP)) = Q[j + lenP] - Q[j]*X**lenP
+Everything is modulo 2**32, so that one lane holds one hash, and the modulo division is free.
+X is odd and != 1, so that, unlike with x == 1, anagrams of P don't collide with it.
+Prefix hashes are computed one block of text at a time, so the memory use is O(lenP + BLOCK_SIZE).
+
+The kernel is chosen at run-time, according to what the CPU supports, so the same binary
+runs on machines without AVX2 (or on non-x86 machines), with the scalar kernel. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif // _MSC_VER
+#endif // X86
+
+#define MAX_NUM_ITEMS 500001                                    // Max length of P and T in stdin mode. +1 for '\0'.
+#define BLOCK_SIZE 4096                                         // Number of windows per block of prefix hashes (at least); a multiple of 16.
+#define X 0x01000193u                                           // Multiplier; odd, so that it's invertible modulo 2**32.
+
+typedef unsigned int uint;
+
+/* Positions of occurences; a growable array. */
+typedef struct Matches Matches;
+
+struct Matches {
+    size_t *pos;
+    size_t len, cap;
+};
+
+void addMatch(Matches *m, size_t pos) {
+    if (m->len == m->cap) {
+        m->cap = m->cap ? m->cap << 1 : 16;
+        m->pos = realloc(m->pos, m->cap * sizeof(*m->pos));
+        if (!m->pos)                                            // if realloc fails
+            exit(-1);
+    }
+    m->pos[m->len++] = pos;
+}
+
+/* Kernel: checks windows [j, j + n) of a block, whose prefix hashes are in Q (Q[0] is at the start of the block).
+T points to the start of the block. n is a multiple of the vector width, except in the scalar kernel. */
+typedef void (*Kernel)(const uint *Q, const char *T, size_t n, const char *P, size_t lenP,
+                       uint pHash, uint xm, size_t base, Matches *m);
+
+void kernelScalar(const uint *Q, const char *T, size_t n, const char *P, size_t lenP,
+                  uint pHash, uint xm, size_t base, Matches *m) {
+    for (size_t j = 0; j < n; j++) {
+        if (Q[j + lenP] - Q[j] * xm == pHash && !memcmp(T + j, P, lenP))
+            addMatch(m, base + j);
+    }
+}
+
+#ifdef X86
+/* Index of the lowest set bit; v must not be 0. */
+#ifdef _MSC_VER
+static uint ctz(uint v) {
+    unsigned long k;
+    _BitScanForward(&k, v);
+    return k;
+}
+#else
+#define ctz(v) (uint)__builtin_ctz(v)
+#endif // _MSC_VER
+
+TARGET_AVX2
+void kernelAVX2(const uint *Q, const char *T, size_t n, const char *P, size_t lenP,
+                uint pHash, uint xm, size_t base, Matches *m) {
+    const __m256i vp = _mm256_set1_epi32((int)pHash);
+    const __m256i vx = _mm256_set1_epi32((int)xm);
+    for (size_t j = 0; j < n; j += 8) {
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(Q + j + lenP));
+        __m256i lo = _mm256_loadu_si256((const __m256i *)(Q + j));
+        __m256i w = _mm256_sub_epi32(hi, _mm256_mullo_epi32(lo, vx));
+        uint bits = (uint)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(w, vp)));
+        while (bits) {
+            uint k = ctz(bits);
+            if (!memcmp(T + j + k, P, lenP))
+                addMatch(m, base + j + k);
+            bits &= bits - 1;                                   // clears the lowest set bit
+        }
+    }
+}
+
+TARGET_AVX512
+void kernelAVX512(const uint *Q, const char *T, size_t n, const char *P, size_t lenP,
+                  uint pHash, uint xm, size_t base, Matches *m) {
+    const __m512i vp = _mm512_set1_epi32((int)pHash);
+    const __m512i vx = _mm512_set1_epi32((int)xm);
+    for (size_t j = 0; j < n; j += 16) {
+        __m512i hi = _mm512_loadu_si512((const void *)(Q + j + lenP));
+        __m512i lo = _mm512_loadu_si512((const void *)(Q + j));
+        __m512i w = _mm512_sub_epi32(hi, _mm512_mullo_epi32(lo, vx));
+        uint bits = (uint)_mm512_cmpeq_epi32_mask(w, vp);
+        while (bits) {
+            uint k = ctz(bits);
+            if (!memcmp(T + j + k, P, lenP))
+                addMatch(m, base + j + k);
+            bits &= bits - 1;
+        }
+    }
+}
+#endif // X86
+
+/* Names are in the same order as kernels[]. */
+static const char *kernelNames[] = { "scalar", "avx2", "avx512" };
+static const int kernelWidths[] = { 1, 8, 16 };
+static const Kernel kernels[] = {
+    kernelScalar,
+#ifdef X86
+    kernelAVX2,
+    kernelAVX512
+#endif // X86
+};
+
+/* Returns the index of the widest kernel that the CPU supports. */
+int detectKernel(void) {
+#ifdef X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return 0;
+    __cpuidex(info, 1, 0);
+    if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)))     // OSXSAVE and AVX
+        return 0;
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)       // AVX512F, and the OS saves ZMM registers
+        return 2;
+    if ((info[1] & (1 << 5)) && (xcr0 & 6) == 6)              // AVX2, and the OS saves YMM registers
+        return 1;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return 2;
+    if (__builtin_cpu_supports("avx2"))
+        return 1;
+#endif // _MSC_VER
+#endif // X86
+    return 0;
+}
+
+/* Finds all occurences of P in T with the given kernel (index into kernels[]).
+Positions are appended to m in increasing order. */
+void RabinKarpSIMD(const char *T, size_t lenT, const char *P, size_t lenP, int kernel, Matches *m) {
+    if (!lenP || lenP > lenT)
+        return;
+
+    const unsigned char *U = (const unsigned char *)T;
+    size_t numWindows = lenT - lenP + 1;
+    size_t width = kernelWidths[kernel];
+    /* Every block recomputes lenP prefix hashes of the next one, so blocks aren't made shorter than P. */
+    size_t blockSize = lenP > BLOCK_SIZE ? (lenP + 15) & ~(size_t)15 : BLOCK_SIZE;
+
+    uint pHash = 0, xm = 1;
+    for (size_t i = 0; i < lenP; i++) {
+        pHash = pHash * X + (unsigned char)P[i];
+        xm *= X;                                                // xm == X**lenP
+    }
+
+    /* Prefix hashes of one block: blockSize windows need blockSize + lenP of them, and Q[0]. */
+    uint *Q = malloc((blockSize + lenP + 1) * sizeof(*Q));
+    if (!Q)                                                     // if malloc fails
+        exit(-1);
+
+    for (size_t base = 0; base < numWindows; base += blockSize) {
+        size_t n = numWindows - base < blockSize ? numWindows - base : blockSize;
+        size_t end = n + lenP;                                  // number of text bytes this block covers
+        Q[0] = 0;
+        for (size_t k = 0; k < end; k++)
+            Q[k + 1] = Q[k] * X + U[base + k];
+
+        /* The vector kernel takes whole vectors; the rest of the block goes to the scalar kernel. */
+        size_t nv = n - n % width;
+        if (nv)
+            kernels[kernel](Q, T + base, nv, P, lenP, pHash, xm, base, m);
+        if (nv < n)
+            kernelScalar(Q + nv, T + base + nv, n - nv, P, lenP, pHash, xm, base + nv, m);
+    }
+
+    free(Q);
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Reads the whole file into memory. */
+char *readFile(const char *name, size_t *len) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(*len + 1);
+    if (!buf || fread(buf, 1, *len, f) != *len)
+        exit(-1);
+    buf[*len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+void printMatches(Matches *m) {
+    for (size_t i = 0; i < m->len; i++)
+        printf("%zu ", m->pos[i]);
+    printf("\n");
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* With no arguments, reads pattern and text from stdin, as "hash_substring.c" does.
+With arguments PATTERN FILE, searches the file.
+With arguments PATTERN FILE bench, times every kernel that the CPU supports, without printing positions. */
+int main(int argc, char *argv[]) {
+    int best = detectKernel();
+    Matches m = { NULL, 0, 0 };
+
+    if (argc < 3) {
+        static char pattern[MAX_NUM_ITEMS], text[MAX_NUM_ITEMS];
+        scanf("%500000s", pattern);
+        scanf("%500000s", text);
+        RabinKarpSIMD(text, strlen(text), pattern, strlen(pattern), best, &m);
+        printMatches(&m);
+        free(m.pos);
+        return 0;
+    }
+
+    size_t lenT;
+    char *T = readFile(argv[2], &lenT);
+
+    if (argc > 3 && !strcmp(argv[3], "bench")) {
+        for (int k = 0; k <= best; k++) {
+            m.len = 0;
+            RabinKarpSIMD(T, lenT, argv[1], strlen(argv[1]), k, &m);   // warmup
+            m.len = 0;
+            double t0 = now();
+            RabinKarpSIMD(T, lenT, argv[1], strlen(argv[1]), k, &m);
+            double diff = now() - t0;
+            printf("%-6s: %.3f s, %.3f GB/s, %zu matches\n", kernelNames[k], diff, lenT / diff * 1e-9, m.len);
+        }
+    }
+    else {
+        RabinKarpSIMD(T, lenT, argv[1], strlen(argv[1]), best, &m);
+        printMatches(&m);
+    }
+
+    free(m.pos);
+    free(T);
+    return 0;
+}
+
+/* Test data:
+
+We should input two strings, in two rows, and the result is
+positions of occurences of the first string in the second one.
+
+Input:
+aba
+abacaba
+Output:
+0 4
+
+Input:
+aaaaa
+baaaaaaa
+Output:
+1 2 3
+
+Benchmark:
+hash_substring_simd Lorem big.txt bench
+Output:
+scalar: ... s, ... GB/s, ... matches
+avx2  : ...
+avx512: ...
+*/
+
+#endif // HASH_SUBSTRING_SIMD
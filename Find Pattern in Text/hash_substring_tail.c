@@ -0,0 +1,358 @@
+//#define HASH_SUBSTRING_TAIL
+#ifdef HASH_SUBSTRING_TAIL
+
+/* Find pattern in a growing text */
+
+/* Tailing a log that grows by appends, and reporting every new occurence of a pattern, as soon as it's appended.
+
+Rerunning RabinKarp() on the whole file after every append costs O(n) per append, where n is the size of the file.
+Instead, a Matcher keeps the state of the search between appends: the rolling hash of the last window,
+the number of bytes seen so far, and the last lenP bytes themselves. feed() takes the appended bytes,
+and rolls the window over them, as if they had been there all along, so it costs O(1) per appended byte,
+plus O(lenP) per hash hit, for verification.
+
+The last lenP bytes are kept for two reasons: the byte that leaves the window, when a byte is appended,
+was appended before, maybe long ago; and a window that straddles the previous append boundary
+has to be verified with bytes from both sides of it. That's why an occurence that straddles
+the boundary is found just like any other one, and it's reported only once, after the append that completes it.
+
+The hash is modulo the Mersenne prime 2**61 - 1 with a random base x, as in "hash_substring_alt.c",
+so that hash hits without an occurence are practically never, and verification costs nothing on average,
+whatever the log contains. Positions are absolute offsets in the stream. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <intrin.h>                                             // _umul128()
+#endif // _MSC_VER
+#ifdef _WIN32
+#include <windows.h>                                            // Sleep()
+#else
+#include <unistd.h>                                             // usleep()
+#endif // _WIN32
+
+#define MAX_NUM_ITEMS 500001                                    // Max length of P and of an appended row in stdin mode. +1 for '\0'.
+#define READ_CHUNK (1u << 16)                                   // Follow mode reads the file in chunks of this many bytes.
+#define POLL_INTERVAL_MS 250                                    // Follow mode checks for new bytes this often, at the end of the file.
+#define TRUE 1
+#define FALSE 0
+#define PRIME 2305843009213693951llu                            // 2**61 - 1
+#define POWER 61                                                // PRIME == 2**POWER - 1
+#define M 0x1fffffffffffffffllu
+#define Q 61
+#define R 0x1fffffffffffffffllu
+
+typedef unsigned long long ull;
+
+/* MATCH SINK CODE */
+
+/* Matchers don't print positions of occurences themselves, but hand them to a sink,
+so that their speed can be measured without the cost of printing.
+The same code is in all hash_substring*.c files; MATCH_SINK lets them be compiled together. */
+#ifndef MATCH_SINK
+#define MATCH_SINK
+
+#define OUT_BUF_SIZE (1u << 20)                                 // Size of the output buffer of writeNumber().
+
+/* Sink modes */
+#define SINK_BUFFER 0                                           // Appends positions to a growable buffer.
+#define SINK_COUNT 1                                            // Only counts matches.
+#define SINK_FIRST_K 2                                          // Appends positions to a growable buffer, and stops the matcher after the first limit of them.
+#define SINK_WRITE 3                                            // Formats positions with writeNumber().
+
+typedef struct MatchSink MatchSink;
+
+struct MatchSink {
+    int mode;
+    size_t count;                                               // number of matches so far
+    size_t limit;                                               // used with SINK_FIRST_K only; must be at least 1
+    ull *pos;                                                   // used with SINK_BUFFER and SINK_FIRST_K only
+    size_t cap;
+};
+
+static char outBuf[OUT_BUF_SIZE];
+static size_t outLen = 0;
+
+/* Writes the output buffer with one large fwrite(), which goes straight to one write() system call. */
+void flushOutput(void) {
+    fwrite(outBuf, 1, outLen, stdout);
+    outLen = 0;
+}
+
+/* Fast formatter.
+Appends decimal v and a space to the output buffer, and flushes it only when it's full. */
+void writeNumber(ull v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (outLen + n + 1 > OUT_BUF_SIZE)
+        flushOutput();
+    while (n)
+        outBuf[outLen++] = digits[--n];
+    outBuf[outLen++] = ' ';
+}
+
+/* Ends the row of positions, and flushes the output buffer. */
+void writeNewLine(void) {
+    if (outLen == OUT_BUF_SIZE)
+        flushOutput();
+    outBuf[outLen++] = '\n';
+    flushOutput();
+}
+
+MatchSink makeSink(int mode, size_t limit) {
+    MatchSink sink = { mode, 0, limit, NULL, 0 };
+    return sink;
+}
+
+/* Hands one position to the sink.
+Returns TRUE if the matcher should go on, or FALSE if it should stop. */
+int sinkAdd(MatchSink *sink, ull pos) {
+    switch (sink->mode) {
+    case SINK_COUNT:
+        sink->count++;
+        return TRUE;
+    case SINK_WRITE:
+        writeNumber(pos);
+        sink->count++;
+        return TRUE;
+    default:                                                    // SINK_BUFFER or SINK_FIRST_K
+        if (sink->count == sink->cap) {
+            sink->cap = sink->cap ? sink->cap << 1 : 16;
+            sink->pos = realloc(sink->pos, sink->cap * sizeof(*sink->pos));
+            if (!sink->pos)                                     // if realloc fails
+                exit(-1);
+        }
+        sink->pos[sink->count++] = pos;
+        return sink->mode == SINK_BUFFER || sink->count < sink->limit;
+    }
+}
+
+void freeSink(MatchSink *sink) {
+    free(sink->pos);
+    sink->pos = NULL;
+    sink->count = sink->cap = 0;
+}
+
+#endif // MATCH_SINK
+
+
+/* HASH CODE */
+
+/* h % PRIME, for h < 2**(2*POWER).
+http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivision */
+ull reduce(ull h) {
+    /* h % PRIME goes into m (modulus) */
+    ull m;
+
+    m = (h & M) + ((h >> POWER) & M);
+
+    for ( ; m > PRIME; )
+        m = (m >> Q) + (m & R);
+
+    return m == PRIME ? 0 : m;
+}
+
+/* a * b % PRIME, for a, b < PRIME. */
+ull mulMod(ull a, ull b) {
+#ifdef _MSC_VER
+    ull hi, lo = _umul128(a, b, &hi);
+    return reduce((lo & M) + ((lo >> POWER) | (hi << (64 - POWER))));
+#else
+    unsigned __int128 p = (unsigned __int128)a * b;
+    return reduce(((ull)p & M) + (ull)(p >> POWER));
+#endif // _MSC_VER
+}
+
+/* A random base in [2, PRIME - 1], from splitmix64 (http://xorshift.di.unimi.it/splitmix64.c). */
+ull randomBase(void) {
+    ull z = (ull)time(NULL) ^ ((ull)clock() << 32) ^ (ull)(size_t)&z;
+    z += 0x9e3779b97f4a7c15llu;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9llu;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebllu;
+    z = z ^ (z >> 31);
+
+    return 2 + z % (PRIME - 2);
+}
+
+
+/* MATCHER CODE */
+
+typedef struct Matcher Matcher;
+
+struct Matcher {
+    unsigned char *P;                                           // a copy of the pattern
+    size_t lenP;
+    ull x, y;                                                   // base, and x**lenP
+    ull pHash;
+    ull h;                                                      // hash of the last min(seen, lenP) bytes
+    ull seen;                                                   // number of bytes fed so far
+    unsigned char *last;                                        // the last lenP bytes fed; last[lenP - 1] is the newest one, and only the last min(seen, lenP) are valid
+};
+
+/* Creates a matcher for P, which hasn't seen any bytes yet. lenP must be at least 1. */
+Matcher *makeMatcher(const char *P, size_t lenP) {
+    Matcher *m = malloc(sizeof(*m));
+    if (!m)                                                     // if malloc fails
+        exit(-1);
+    m->P = malloc(lenP);
+    m->last = malloc(lenP);
+    if (!m->P || !m->last)                                      // if malloc fails
+        exit(-1);
+    memcpy(m->P, P, lenP);
+    m->lenP = lenP;
+    m->x = randomBase();
+    m->y = 1;
+    m->pHash = 0;
+    for (size_t i = 0; i < lenP; i++) {
+        m->pHash = reduce(mulMod(m->pHash, m->x) + m->P[i]);
+        m->y = mulMod(m->y, m->x);
+    }
+    m->h = 0;
+    m->seen = 0;
+    return m;
+}
+
+void freeMatcher(Matcher *m) {
+    free(m->P);
+    free(m->last);
+    free(m);
+}
+
+/* Is the window that ends at buf[j] equal to P? Its first bytes may have been fed before buf. */
+int windowEqual(const Matcher *m, const unsigned char *buf, size_t j) {
+    size_t fromBuf = j + 1 < m->lenP ? j + 1 : m->lenP;
+    size_t fromLast = m->lenP - fromBuf;
+    return !memcmp(m->P, m->last + fromBuf, fromLast) && !memcmp(m->P + fromLast, buf + j + 1 - fromBuf, fromBuf);
+}
+
+/* Feeds n more bytes to the matcher, and hands the positions of the occurences of P that end in them to the sink.
+O(1) per byte, plus O(lenP) per hash hit. Returns FALSE if the sink wants no more positions (and then the bytes
+after the last reported occurence aren't fed), or TRUE. */
+int feed(Matcher *m, const char *bytes, size_t n, MatchSink *sink) {
+    const unsigned char *buf = (const unsigned char *)bytes;
+    size_t lenP = m->lenP;
+    ull x = m->x, y = m->y, h = m->h, seen = m->seen;
+    int goOn = TRUE;
+    size_t j;
+
+    for (j = 0; j < n && goOn; j++) {
+        if (seen >= lenP) {
+            unsigned char out = j < lenP ? m->last[j] : buf[j - lenP];      // the byte that leaves the window
+            h = reduce(mulMod(h, x) + buf[j] + PRIME - mulMod(y, out));     // h = h*x + buf[j] - y*out
+        }
+        else
+            h = reduce(mulMod(h, x) + buf[j]);
+        seen++;
+        if (seen >= lenP && h == m->pHash && windowEqual(m, buf, j))
+            goOn = sinkAdd(sink, seen - lenP);
+    }
+
+    /* Keeps the last lenP bytes, for the next feed(). */
+    if (j >= lenP)
+        memcpy(m->last, buf + j - lenP, lenP);
+    else {
+        memmove(m->last, m->last + j, lenP - j);
+        memcpy(m->last + lenP - j, buf, j);
+    }
+    m->h = h;
+    m->seen = seen;
+    return goOn;
+}
+
+void sleepMs(unsigned ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000u);
+#endif // _WIN32
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* With no arguments, reads the pattern from the first row of stdin, and then feeds every following row to the matcher,
+as an append (without the new line), and prints a row with the positions of the new occurences after each one.
+With arguments PATTERN FILE, follows the file like "tail -f": it feeds what's in it, and then, forever,
+what's appended to it, and prints a row with the positions of the new occurences whenever there are some. */
+int main(int argc, char *argv[]) {
+    MatchSink sink = makeSink(SINK_WRITE, 0);
+
+    if (argc < 3) {
+        static char pattern[MAX_NUM_ITEMS], row[MAX_NUM_ITEMS];
+        if (scanf("%500000s", pattern) != 1)
+            return 1;
+        Matcher *m = makeMatcher(pattern, strlen(pattern));
+        while (scanf("%500000s", row) == 1) {
+            feed(m, row, strlen(row), &sink);
+            writeNewLine();
+        }
+        freeMatcher(m);
+        return 0;
+    }
+
+    if (!*argv[1])
+        return 1;
+    FILE *f = fopen(argv[2], "rb");
+    if (!f) {
+        perror(argv[2]);
+        return 1;
+    }
+    Matcher *m = makeMatcher(argv[1], strlen(argv[1]));
+    static char buf[READ_CHUNK];
+    for (;;) {
+        size_t n = fread(buf, 1, READ_CHUNK, f);
+        if (!n) {
+            clearerr(f);                                        // so that the next fread() tries again, past the end of the file
+            sleepMs(POLL_INTERVAL_MS);
+            continue;
+        }
+        size_t before = sink.count;
+        feed(m, buf, n, &sink);
+        if (sink.count != before) {
+            writeNewLine();
+            fflush(stdout);                                     // stdout may be a pipe or a file, and this program never ends
+        }
+    }
+}
+
+/* Test data:
+
+We should input the pattern, and then the appends, one per row.
+The result is a row of positions of new occurences after every append.
+
+Input:
+aba
+ab
+acab
+a
+Output:
+
+0
+4
+
+Input (occurences straddle the boundaries, and the second one overlaps the first one):
+aaa
+a
+aa
+aa
+a
+Output:
+
+0
+1 2
+3
+
+Follow mode (hash_substring_tail ERROR app.log, while another program appends to app.log):
+Output is a row of positions (byte offsets) of new occurences of ERROR, whenever some are appended.
+*/
+
+#endif // HASH_SUBSTRING_TAIL
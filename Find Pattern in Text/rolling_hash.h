@@ -0,0 +1,211 @@
+/* Rolling hash "template" */
+
+/* hash_substring.c, hash_substring_a.c and hash_substring_alt.c are the same Rabin-Karp, with a different modulus
+and a different way to reduce modulo it (% PRIME, or the bit tricks with M, Q and R for a Mersenne prime),
+chosen with #define and #ifdef. This header is that Rabin-Karp once, parameterized on the modulus,
+the base and the reduction policy, and every combination of them is a separate instantiation:
+the parameters are macros, the functions are generated with their names, and everything is a compile-time constant
+in them, so the compiler specializes the hot loop for each one (a division by a constant becomes a multiplication,
+Barrett and Montgomery constants are folded, a multiplication by a small base becomes shifts and adds).
+
+Usage, like a C++ template, but with the preprocessor; this header can be included any number of times:
+    #define RH_NAME rkMersenne61                                // prefix of the generated functions
+    #define RH_POLICY RH_MERSENNE61                             // reduction policy
+    #define RH_BASE 263                                         // base; in [2, modulus - 1]
+    #include "rolling_hash.h"
+generates:
+    ull rkMersenne61Hash(const unsigned char *s, size_t n);
+    size_t rkMersenne61Search(const unsigned char *T, size_t lenT, const unsigned char *P, size_t lenP,
+                              int (*onMatch)(void *ctx, size_t pos), void *ctx);
+Search() hands every verified occurence to onMatch() (which may be NULL), stops when it returns 0,
+and returns the number of occurences.
+
+Reduction policies:
+    RH_PERCENT      a * b % RH_MODULUS; RH_MODULUS < 2**31 (default 1000000007). RH_MODULUS may be a variable, too,
+                    and then it's what the other policies are compared to: a real division per multiplication.
+    RH_BARRETT      Barrett reduction, with mu = floor(2**64 / RH_MODULUS); RH_MODULUS < 2**31.
+    RH_MONTGOMERY   Montgomery multiplication, with R = 2**32; RH_MODULUS is odd and < 2**31.
+                    Constants (the base and its power) are kept in Montgomery form, hashes in ordinary form,
+                    so hashes are the same as with the other policies with the same modulus.
+    RH_MERSENNE31   modulo 2**31 - 1, with shifts and masks.
+    RH_MERSENNE61   modulo 2**61 - 1, with a 128-bit multiplication, shifts and masks, as in "hash_substring_alt.c".
+
+Verification is with memcmp(), so all instantiations report exactly the same positions; they differ in speed,
+and in the probability of a hash hit without an occurence (about 1 / modulus per window). */
+
+#ifndef ROLLING_HASH_H
+#define ROLLING_HASH_H
+
+#include <stddef.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>                                             // _umul128(), __umulh()
+#endif // _MSC_VER
+
+#define RH_PERCENT 1
+#define RH_BARRETT 2
+#define RH_MONTGOMERY 3
+#define RH_MERSENNE31 4
+#define RH_MERSENNE61 5
+
+#define RH_DEFAULT_MODULUS 1000000007u
+#define RH_MERSENNE31_MODULUS 0x7fffffffu                       // 2**31 - 1
+#define RH_MERSENNE61_MODULUS 0x1fffffffffffffffllu             // 2**61 - 1
+
+typedef unsigned long long ull;
+
+/* (a * b + d) % (2**31 - 1), for a, b < 2**31 - 1, d < 2**32. */
+static inline ull rhMulAddMersenne31(ull a, ull b, ull d) {
+    ull x = a * b + d;                                          // < 2**63
+    x = (x & RH_MERSENNE31_MODULUS) + (x >> 31);                // < 2**33
+    x = (x & RH_MERSENNE31_MODULUS) + (x >> 31);                // < 2**31 + 4
+    return x >= RH_MERSENNE31_MODULUS ? x - RH_MERSENNE31_MODULUS : x;
+}
+
+/* (a * b + d) % (2**61 - 1), for a, b < 2**61 - 1, d < 2**62. */
+static inline ull rhMulAddMersenne61(ull a, ull b, ull d) {
+#ifdef _MSC_VER
+    ull hi, lo = _umul128(a, b, &hi);
+    lo += d;
+    hi += lo < d;                                               // carry; hi:lo < 2**123
+    ull x = (lo & RH_MERSENNE61_MODULUS) + ((lo >> 61) | (hi << 3));        // < 2**63
+#else
+    unsigned __int128 p = (unsigned __int128)a * b + d;         // < 2**123
+    ull x = ((ull)p & RH_MERSENNE61_MODULUS) + (ull)(p >> 61);  // < 2**63
+#endif // _MSC_VER
+    x = (x & RH_MERSENNE61_MODULUS) + (x >> 61);                // < 2**61 + 4
+    return x >= RH_MERSENNE61_MODULUS ? x - RH_MERSENNE61_MODULUS : x;
+}
+
+/* x % p, for any x, p < 2**31, with mu == floor(2**64 / p). */
+static inline ull rhBarrett(ull x, ull p, ull mu) {
+#ifdef _MSC_VER
+    ull q = __umulh(x, mu);                                     // q is x / p, or one less
+#else
+    ull q = (ull)(((unsigned __int128)x * mu) >> 64);           // q is x / p, or one less
+#endif // _MSC_VER
+    ull r = x - q * p;
+    return r >= p ? r - p : r;
+}
+
+/* x / 2**32 % p, for x < p * 2**32, p odd and < 2**31, with pInv == -1 / p % 2**32 (Montgomery's REDC). */
+static inline ull rhRedc(ull x, ull p, unsigned pInv) {
+    unsigned m = (unsigned)x * pInv;                            // x + m*p is divisible by 2**32
+    ull t = (x + (ull)m * p) >> 32;                             // x + m*p < 2**64, since p < 2**31
+    return t >= p ? t - p : t;
+}
+
+/* Constant expressions for the policy constants, so that they are folded at compile time.
+2**64 doesn't fit in 64 bits, so they are computed from 2**64 - 1, without a 128-bit type. */
+#define RH_BARRETT_MU(p) (~0ull / (p) + (~0ull % (p) + 1 == (p)))                 // floor(2**64 / p)
+#define RH_MONTGOMERY_R2(p) ((~0ull % (p) + 1) % (p))                           // 2**64 % p
+/* 1 / p % 2**32 by Newton's iteration; p is its own inverse modulo 2**3, and every step doubles the number of correct bits. */
+#define RH_INV_STEP(p, i) ((unsigned)(i) * (2u - (unsigned)(p) * (unsigned)(i)))
+#define RH_INV32(p) RH_INV_STEP(p, RH_INV_STEP(p, RH_INV_STEP(p, RH_INV_STEP(p, (unsigned)(p)))))
+#define RH_MONTGOMERY_PINV(p) (0u - RH_INV32(p))
+
+#define RH_CAT_(a, b) a##b
+#define RH_CAT(a, b) RH_CAT_(a, b)
+
+#endif // ROLLING_HASH_H
+
+
+/* THE TEMPLATE: instantiated once per inclusion, with the parameters that are defined at that time. */
+
+#ifdef RH_NAME
+
+#ifndef RH_POLICY
+#define RH_POLICY RH_MERSENNE61
+#endif // RH_POLICY
+#ifndef RH_BASE
+#define RH_BASE 263
+#endif // RH_BASE
+
+/* RH_MOD is the modulus.
+RH_MULADD(a, c, d) is (a * c + d) % RH_MOD, for a < RH_MOD, a constant c that was prepared with RH_PREPARE(),
+and an addend d < 2 * RH_MOD that was prepared with RH_ADDEND(). It's one multiplication and one reduction,
+and it's all there is on the critical path of the rolling hash: every other operation is independent of the hash. */
+#if RH_POLICY == RH_MERSENNE61
+#define RH_MOD RH_MERSENNE61_MODULUS
+#define RH_MULADD(a, c, d) rhMulAddMersenne61(a, c, d)
+#define RH_PREPARE(c) (c)
+#define RH_ADDEND(d) (d)
+#elif RH_POLICY == RH_MERSENNE31
+#define RH_MOD ((ull)RH_MERSENNE31_MODULUS)
+#define RH_MULADD(a, c, d) rhMulAddMersenne31(a, c, d)
+#define RH_PREPARE(c) (c)
+#define RH_ADDEND(d) (d)
+#else
+#ifndef RH_MODULUS
+#define RH_MODULUS RH_DEFAULT_MODULUS
+#endif // RH_MODULUS
+#define RH_MOD ((ull)(RH_MODULUS))
+#if RH_POLICY == RH_PERCENT
+#define RH_MULADD(a, c, d) (((a) * (c) + (d)) % RH_MOD)
+#define RH_PREPARE(c) (c)
+#define RH_ADDEND(d) (d)
+#elif RH_POLICY == RH_BARRETT
+#define RH_MULADD(a, c, d) rhBarrett((a) * (c) + (d), RH_MOD, RH_BARRETT_MU(RH_MOD))
+#define RH_PREPARE(c) (c)
+#define RH_ADDEND(d) (d)
+#elif RH_POLICY == RH_MONTGOMERY
+#define RH_MULADD(a, c, d) rhRedc((a) * (c) + (d), RH_MOD, RH_MONTGOMERY_PINV(RH_MOD))
+#define RH_PREPARE(c) (((ull)(c) << 32) % RH_MOD)               // c * 2**32 % RH_MOD: REDC(a * that) == a * c % RH_MOD
+#define RH_ADDEND(d) rhRedc((ull)(d) * RH_MONTGOMERY_R2(RH_MOD), RH_MOD, RH_MONTGOMERY_PINV(RH_MOD))      // d * 2**32 % RH_MOD, so that REDC(a * c + that) == (a * c + d) % RH_MOD
+#else
+#error "unknown RH_POLICY"
+#endif // RH_POLICY
+#endif // RH_POLICY == RH_MERSENNE61
+
+#define RH_MUL(a, c) RH_MULADD(a, c, (ull)0)
+
+/* Hash of s[0..n): s[0]*x**(n-1) + s[1]*x**(n-2) + ... + s[n-1], so that it can be rolled forward. */
+static ull RH_CAT(RH_NAME, Hash)(const unsigned char *s, size_t n) {
+    const ull x = RH_PREPARE((ull)RH_BASE % RH_MOD);
+    ull h = 0;
+    for (size_t i = 0; i < n; i++)
+        h = RH_MULADD(h, x, RH_ADDEND((ull)s[i]));
+    return h;
+}
+
+/* Rabin-Karp: hands positions of occurences of P in T to onMatch(), in order. Returns their number. */
+static size_t RH_CAT(RH_NAME, Search)(const unsigned char *T, size_t lenT, const unsigned char *P, size_t lenP,
+                                      int (*onMatch)(void *ctx, size_t pos), void *ctx) {
+    if (!lenP || lenP > lenT)
+        return 0;
+
+    const ull x = RH_PREPARE((ull)RH_BASE % RH_MOD);
+    ull y = 1 % RH_MOD;                                         // x**lenP, in ordinary form
+    for (size_t i = 0; i < lenP; i++)
+        y = RH_MUL(y, x);
+    const ull yP = RH_PREPARE(y);
+
+    const ull pHash = RH_CAT(RH_NAME, Hash)(P, lenP);
+    ull h = RH_CAT(RH_NAME, Hash)(T, lenP);
+    size_t numMatches = 0, last = lenT - lenP;
+
+    for (size_t i = 0; ; i++) {
+        if (h == pHash && !memcmp(T + i, P, lenP)) {
+            numMatches++;
+            if (onMatch && !onMatch(ctx, i))
+                break;
+        }
+        if (i == last)
+            break;
+        ull d = (ull)T[i + lenP] + RH_MOD - RH_MUL((ull)T[i], yP);      // T[i + lenP] - y*T[i], in [1, 2 * RH_MOD)
+        h = RH_MULADD(h, x, RH_ADDEND(d));                      // h = h*x + T[i + lenP] - y*T[i]
+    }
+    return numMatches;
+}
+
+#undef RH_NAME
+#undef RH_POLICY
+#undef RH_BASE
+#undef RH_MODULUS
+#undef RH_MOD
+#undef RH_MUL
+#undef RH_MULADD
+#undef RH_PREPARE
+#undef RH_ADDEND
+
+#endif // RH_NAME
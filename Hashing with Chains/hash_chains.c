@@ -28,6 +28,7 @@ this example won't work as expected, even with the same code for hash function.
 #define PRIME 1000000007u                                       // This value must not be changed.
 #define X 263                                                   // Multiplier; this value must not be changed.
 #define MAX_STRING_LEN 16                                       // 15 + 1 for the terminating character
+#define SLAB_SIZE 4096                                          // Number of elements per slab
 
 /* HASH TABLE CODE */
 
@@ -41,6 +42,63 @@ struct Element {
     Element *prev, *next;
 };
 
+/* POOL ALLOCATOR CODE */
+
+/* The pool is global, too. Elements are taken from slabs of SLAB_SIZE Elements, instead of malloc()
+per Element, erase() puts them on a free list, for insert() to reuse, and freeHashTable() frees whole slabs,
+instead of walking the chains. */
+
+typedef struct Pool Pool;
+
+struct Pool {
+    Element **slabs;                                            // all elements are in slabs, which are freed at once
+    size_t numSlabs, capSlabs;
+    size_t slabUsed;                                            // number of used elements in the last slab
+    Element *freeList;                                          // erased elements, linked through next
+};
+
+Pool pool = { NULL, 0, 0, SLAB_SIZE, NULL };
+
+/* Returns a new element: an erased one, from the free list, or the next one in the last slab. */
+Element *allocElement(void) {
+    Element *ep = pool.freeList;
+    if (ep) {
+        pool.freeList = ep->next;
+        return ep;
+    }
+    if (pool.slabUsed == SLAB_SIZE) {
+        if (pool.numSlabs == pool.capSlabs) {
+            pool.capSlabs = pool.capSlabs ? pool.capSlabs << 1 : 16;
+            pool.slabs = realloc(pool.slabs, pool.capSlabs * sizeof(*pool.slabs));
+            if (!pool.slabs)                                    // if realloc fails
+                exit(-1);
+        }
+        pool.slabs[pool.numSlabs] = malloc(SLAB_SIZE * sizeof(**pool.slabs));
+        if (!pool.slabs[pool.numSlabs])                         // if malloc fails
+            exit(-1);
+        pool.numSlabs++;
+        pool.slabUsed = 0;
+    }
+    return &pool.slabs[pool.numSlabs - 1][pool.slabUsed++];
+}
+
+/* Puts an erased element on the free list. */
+void freeElement(Element *ep) {
+    ep->next = pool.freeList;
+    pool.freeList = ep;
+}
+
+/* Frees all slabs, and all elements with them. */
+void freePool(void) {
+    for (size_t i = 0; i < pool.numSlabs; i++)
+        free(pool.slabs[i]);
+    free(pool.slabs);
+    pool.slabs = NULL;
+    pool.numSlabs = pool.capSlabs = 0;
+    pool.slabUsed = SLAB_SIZE;
+    pool.freeList = NULL;
+}
+
 /* Hash function for strings. */
 size_t hash(char *s) {
     unsigned long long h = 0;
@@ -90,9 +148,7 @@ void insert(Element **hashTable, char *s) {
     /* Pointer to Element. */
     Element *ep = NULL;
     if (!(ep = _find(hashTable, s))) {                          // not found
-        ep = malloc(sizeof(*ep));                               // sizeof(Element)
-        if (!ep)                                                // if malloc fails
-            exit(-1);
+        ep = allocElement();
         size_t hashValue = hash(s);
         strcpy(ep->s, s);
         ep->prev = NULL;                                        // this element will be the first one in the bucket
@@ -116,23 +172,15 @@ void erase(Element **hashTable, char *s) {
         ep->prev->next = ep->next;
     if (ep->next)
         ep->next->prev = ep->prev;
-    free(ep);
+    freeElement(ep);
 }
 
-/* Destroys the given hash table. */
+/* Destroys the given hash table.
+All of its elements are in the pool, so it frees whole slabs, without walking the chains.
+The buckets are still the caller's to free. */
 void freeHashTable(Element **hashTable) {
-    /* Pointer to Element. */
-    Element *ep = NULL;
-    for (size_t i = 0; i < numBuckets; i++) {
-        if (hashTable[i]) {
-            Element *epn = NULL;
-            for (ep = hashTable[i]; ep->next != NULL; ep = epn) {
-                epn = ep->next;
-                free(ep);
-            }
-            free(ep);
-        }
-    }
+    (void)hashTable;
+    freePool();
 }
 
 
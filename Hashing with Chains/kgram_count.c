@@ -0,0 +1,492 @@
+//#define KGRAM_COUNT
+#ifdef KGRAM_COUNT
+
+/* Counting k-grams, in parallel */
+
+/* Counts the occurences of every k-gram (substring of length k) of a text, and prints the most frequent ones.
+
+The keys are 64-bit fingerprints of k-grams, and not the k-grams themselves: the window hash
+is rolled over the text, modulo the Mersenne prime 2**61 - 1 with a random base x,
+as in "Find Pattern in Text/hash_substring_alt.c", so every k-gram costs O(1), whatever k is.
+Two different k-grams get the same fingerprint with probability about k / 2**61, which is practically never.
+The position of the first occurence of a k-gram is kept, so that the k-gram itself can be printed.
+
+The text is split into one chunk per thread, like in "Find Pattern in Text/hash_substring_parallel.c"
+(every chunk is extended by k - 1 bytes into the next one), and every thread counts into its own tables,
+so that threads never wait for each other. The tables are built like the chained table of "hash_chains.c":
+an array of buckets, each one a list of elements; but the buckets are a power of two, the elements are allocated
+in slabs instead of one by one, and a table doubles its buckets when it has more elements than buckets.
+
+Every thread has one table per partition of the fingerprints (as many partitions as threads).
+That's what makes the merge parallel too: thread p merges tables of partition p of all threads,
+and no two threads touch the same table. Then every thread selects the top N of its partition
+with a min-heap, and the top N of all of them are printed.
+
+Uses POSIX threads (link with -pthread). */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define K 8                                                     // Default length of k-grams
+#define TOP 10                                                  // Default number of most frequent k-grams to print
+#define MAX_THREADS 256
+#define MIN_CHUNK_SIZE (1u << 16)                               // Smaller texts are not split into that many chunks, because threads would cost more than they'd save.
+#define MIN_INITIAL_BITS 12
+#define MAX_INITIAL_BITS 22                                     // A table gets a bucket per k-gram it may count, but at most 2**MAX_INITIAL_BITS buckets up front.
+#define SLAB_SIZE 4096                                          // Number of elements per slab
+#define BATCH 16                                                // Fingerprints are computed this many at a time, and their buckets prefetched, before they are added.
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define PREFETCH(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#else
+#define PREFETCH(p) __builtin_prefetch(p)
+#endif
+#define PRIME 2305843009213693951llu                            // 2**61 - 1
+#define POWER 61                                                // PRIME == 2**POWER - 1
+#define M 0x1fffffffffffffffllu
+#define Q 61
+#define R 0x1fffffffffffffffllu
+#define GOLDEN 0x9e3779b97f4a7c15llu                            // 2**64 / golden ratio; spreads fingerprints over the buckets
+
+typedef unsigned long long ull;
+
+/* HASH CODE */
+
+/* h % PRIME, for h < 2**(2*POWER).
+http://graphics.stanford.edu/~seander/bithacks.html#ModulusDivision */
+ull reduce(ull h) {
+    /* h % PRIME goes into m (modulus) */
+    ull m;
+
+    m = (h & M) + ((h >> POWER) & M);
+
+    for ( ; m > PRIME; )
+        m = (m >> Q) + (m & R);
+
+    return m == PRIME ? 0 : m;
+}
+
+/* a * b % PRIME, for a, b < PRIME. */
+ull mulMod(ull a, ull b) {
+    unsigned __int128 p = (unsigned __int128)a * b;
+    return reduce(((ull)p & M) + (ull)(p >> POWER));
+}
+
+/* A random base in [2, PRIME - 1], from splitmix64 (http://xorshift.di.unimi.it/splitmix64.c). */
+ull randomBase(void) {
+    ull z = (ull)time(NULL) ^ ((ull)clock() << 32) ^ (ull)(size_t)&z;
+    z += 0x9e3779b97f4a7c15llu;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9llu;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebllu;
+    z = z ^ (z >> 31);
+
+    return 2 + z % (PRIME - 2);
+}
+
+
+/* HASH TABLE CODE */
+
+typedef struct Element Element;
+
+struct Element {
+    ull key;                                                    // fingerprint of the k-gram
+    size_t pos;                                                 // position of its first occurence
+    ull count;
+    Element *next;
+};
+
+typedef struct Table Table;
+
+struct Table {
+    Element **buckets;
+    int bits;                                                   // number of buckets == 2**bits
+    size_t numElements;
+    Element **slabs;                                            // all elements are in slabs, which are freed at once
+    size_t numSlabs, capSlabs;
+    size_t slabUsed;                                            // number of used elements in the last slab
+};
+
+/* Initializes a table for up to numKgrams k-grams; it grows past that. */
+void initTable(Table *t, size_t numKgrams) {
+    for (t->bits = MIN_INITIAL_BITS; t->bits < MAX_INITIAL_BITS && ((size_t)1 << t->bits) < numKgrams; t->bits++)
+        ;
+    t->buckets = calloc((size_t)1 << t->bits, sizeof(*t->buckets));
+    t->numElements = 0;
+    t->slabs = NULL;
+    t->numSlabs = t->capSlabs = 0;
+    t->slabUsed = SLAB_SIZE;
+    if (!t->buckets)                                            // if calloc fails
+        exit(-1);
+}
+
+size_t bucketOf(const Table *t, ull key) {
+    return (size_t)((key * GOLDEN) >> (64 - t->bits));
+}
+
+Element *newElement(Table *t) {
+    if (t->slabUsed == SLAB_SIZE) {
+        if (t->numSlabs == t->capSlabs) {
+            t->capSlabs = t->capSlabs ? t->capSlabs << 1 : 16;
+            t->slabs = realloc(t->slabs, t->capSlabs * sizeof(*t->slabs));
+            if (!t->slabs)                                      // if realloc fails
+                exit(-1);
+        }
+        t->slabs[t->numSlabs] = malloc(SLAB_SIZE * sizeof(**t->slabs));
+        if (!t->slabs[t->numSlabs])                             // if malloc fails
+            exit(-1);
+        t->numSlabs++;
+        t->slabUsed = 0;
+    }
+    return &t->slabs[t->numSlabs - 1][t->slabUsed++];
+}
+
+/* Doubles the number of buckets, and relinks all elements; elements don't move. */
+void growBuckets(Table *t) {
+    Element **old = t->buckets;
+    size_t oldSize = (size_t)1 << t->bits;
+    t->bits++;
+    t->buckets = calloc((size_t)1 << t->bits, sizeof(*t->buckets));
+    if (!t->buckets)                                            // if calloc fails
+        exit(-1);
+    for (size_t i = 0; i < oldSize; i++) {
+        Element *ep, *epn;
+        for (ep = old[i]; ep != NULL; ep = epn) {
+            epn = ep->next;
+            size_t b = bucketOf(t, ep->key);
+            ep->next = t->buckets[b];
+            t->buckets[b] = ep;
+        }
+    }
+    free(old);
+}
+
+/* Adds count occurences of the k-gram with fingerprint key, first seen at pos. */
+void add(Table *t, ull key, size_t pos, ull count) {
+    size_t b = bucketOf(t, key);
+    Element *ep;
+    for (ep = t->buckets[b]; ep != NULL; ep = ep->next) {
+        if (ep->key == key) {
+            ep->count += count;
+            if (pos < ep->pos)
+                ep->pos = pos;
+            return;
+        }
+    }
+    if (t->numElements >= ((size_t)1 << t->bits)) {
+        growBuckets(t);
+        b = bucketOf(t, key);
+    }
+    ep = newElement(t);
+    ep->key = key;
+    ep->pos = pos;
+    ep->count = count;
+    ep->next = t->buckets[b];                                   // adds this element as the first one in the bucket
+    t->buckets[b] = ep;
+    t->numElements++;
+}
+
+/* Destroys the given hash table. */
+void freeTable(Table *t) {
+    for (size_t i = 0; i < t->numSlabs; i++)
+        free(t->slabs[i]);
+    free(t->slabs);
+    free(t->buckets);
+    t->slabs = NULL;
+    t->buckets = NULL;
+}
+
+
+/* TOP-N CODE */
+
+/* Is a more frequent than b? Equal counts are ordered by first occurence. */
+int moreFrequent(const Element *a, const Element *b) {
+    return a->count != b->count ? a->count > b->count : a->pos < b->pos;
+}
+
+int compareByCount(const void *a, const void *b) {
+    return moreFrequent(a, b) ? -1 : moreFrequent(b, a);
+}
+
+/* Restores the min-heap (the least frequent element at the root) below i. */
+void siftDown(Element *heap, size_t n, size_t i) {
+    for (;;) {
+        size_t least = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && moreFrequent(&heap[least], &heap[l]))
+            least = l;
+        if (r < n && moreFrequent(&heap[least], &heap[r]))
+            least = r;
+        if (least == i)
+            return;
+        Element tmp = heap[i];
+        heap[i] = heap[least];
+        heap[least] = tmp;
+        i = least;
+    }
+}
+
+/* Copies the top most frequent elements of t into heap (which has room for top), and returns their number. */
+size_t selectTop(const Table *t, Element *heap, size_t top) {
+    size_t n = 0;
+    for (size_t s = 0; top && s < t->numSlabs; s++) {
+        size_t used = s + 1 == t->numSlabs ? t->slabUsed : SLAB_SIZE;
+        for (size_t i = 0; i < used; i++) {
+            const Element *ep = &t->slabs[s][i];
+            if (n < top) {
+                heap[n++] = *ep;
+                if (n == top)
+                    for (size_t j = top / 2; j-- > 0; )
+                        siftDown(heap, n, j);
+            }
+            else if (moreFrequent(ep, &heap[0])) {
+                heap[0] = *ep;
+                siftDown(heap, n, 0);
+            }
+        }
+    }
+    return n;
+}
+
+
+/* PARALLEL CODE */
+
+typedef struct Worker Worker;
+
+struct Worker {
+    const unsigned char *T;
+    size_t start, end;                                          // k-grams that start in [start, end)
+    size_t k;
+    ull x, y;                                                   // base, and x**k
+    int id, numParts;
+    Table *parts;                                               // numParts tables
+    Worker *all;                                                // all workers, for the merge
+    int numWorkers;
+    Element *top;                                               // top N of partition id, after the merge
+    size_t numTop, maxTop;
+};
+
+/* Partition of a fingerprint; its high bits, which are uniform, since fingerprints are uniform in [0, PRIME). */
+int partOf(ull key, int numParts) {
+    return (int)(((key >> (POWER - 32)) * (ull)numParts) >> 32);
+}
+
+/* Rolls the fingerprint over the chunk, BATCH k-grams at a time: most of the time goes to cache misses on buckets,
+so their buckets are prefetched before any of them is added. */
+void *countChunk(void *arg) {
+    Worker *w = arg;
+    const unsigned char *T = w->T;
+    size_t k = w->k;
+    ull keys[BATCH];
+    ull h = 0;
+    for (size_t i = w->start; i < w->start + k; i++)
+        h = reduce(mulMod(h, w->x) + T[i]);
+
+    for (size_t i = w->start; i < w->end; i += BATCH) {
+        size_t n = w->end - i < BATCH ? w->end - i : BATCH;
+        for (size_t j = 0; j < n; j++) {
+            keys[j] = h;
+            Table *t = &w->parts[partOf(h, w->numParts)];
+            PREFETCH(&t->buckets[bucketOf(t, h)]);
+            if (i + j + 1 < w->end)
+                h = reduce(mulMod(h, w->x) + T[i + j + k] + PRIME - mulMod(w->y, T[i + j]));    // h = h*x + T[i + j + k] - y*T[i + j]
+        }
+        for (size_t j = 0; j < n; j++)
+            add(&w->parts[partOf(keys[j], w->numParts)], keys[j], i + j, 1);
+    }
+    return NULL;
+}
+
+/* Merges partition id of all workers into the table of this worker, and selects its top N. */
+void *mergePartition(void *arg) {
+    Worker *w = arg;
+    Table *dst = &w->parts[w->id];
+    for (int t = 0; t < w->numWorkers; t++) {
+        if (t == w->id)
+            continue;
+        Table *src = &w->all[t].parts[w->id];
+        for (size_t s = 0; s < src->numSlabs; s++) {
+            size_t used = s + 1 == src->numSlabs ? src->slabUsed : SLAB_SIZE;
+            for (size_t i = 0; i < used; i++)
+                add(dst, src->slabs[s][i].key, src->slabs[s][i].pos, src->slabs[s][i].count);
+        }
+        freeTable(src);
+    }
+    w->top = malloc((w->maxTop ? w->maxTop : 1) * sizeof(*w->top));
+    if (!w->top)                                                // if malloc fails
+        exit(-1);
+    w->numTop = selectTop(dst, w->top, w->maxTop);
+    return NULL;
+}
+
+/* Runs f on all workers, worker 0 on the calling thread. */
+void runAll(Worker *workers, int numWorkers, void *(*f)(void *)) {
+    pthread_t threads[MAX_THREADS];
+    for (int t = 1; t < numWorkers; t++) {
+        if (pthread_create(&threads[t], NULL, f, &workers[t]))
+            exit(-1);
+    }
+    f(&workers[0]);
+    for (int t = 1; t < numWorkers; t++)
+        pthread_join(threads[t], NULL);
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Prints s[0..n), with control characters and backslashes escaped, so that a k-gram stays on one row. */
+void printEscaped(const unsigned char *s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == '\\')
+            printf("\\\\");
+        else if (s[i] == '\n')
+            printf("\\n");
+        else if (s[i] == '\t')
+            printf("\\t");
+        else if (s[i] < 32 || s[i] == 127)
+            printf("\\x%02x", s[i]);
+        else
+            putchar(s[i]);
+    }
+}
+
+/* Counts the k-grams of T with numThreads threads, and prints the number of k-grams, the number of distinct ones,
+and the top most frequent ones, as rows "count k-gram". Timings go to stderr. */
+void countKgrams(const unsigned char *T, size_t lenT, size_t k, int numThreads, size_t top) {
+    if (!k || k > lenT) {
+        printf("0 0\n");
+        return;
+    }
+    size_t numKgrams = lenT - k + 1;
+    if ((size_t)numThreads > numKgrams / MIN_CHUNK_SIZE)
+        numThreads = numKgrams / MIN_CHUNK_SIZE ? (int)(numKgrams / MIN_CHUNK_SIZE) : 1;
+
+    ull x = randomBase(), y = 1;
+    for (size_t i = 0; i < k; i++)
+        y = mulMod(y, x);
+
+    Worker workers[MAX_THREADS];
+    for (int t = 0; t < numThreads; t++) {
+        Worker *w = &workers[t];
+        w->T = T;
+        w->start = numKgrams / numThreads * t;
+        w->end = t + 1 == numThreads ? numKgrams : numKgrams / numThreads * (t + 1);
+        w->k = k;
+        w->x = x;
+        w->y = y;
+        w->id = t;
+        w->numParts = numThreads;
+        w->parts = malloc(numThreads * sizeof(*w->parts));
+        if (!w->parts)                                          // if malloc fails
+            exit(-1);
+        for (int p = 0; p < numThreads; p++)
+            initTable(&w->parts[p], (w->end - w->start) / numThreads);
+        w->all = workers;
+        w->numWorkers = numThreads;
+        w->maxTop = top;
+    }
+
+    double t0 = now();
+    runAll(workers, numThreads, countChunk);
+    double t1 = now();
+    runAll(workers, numThreads, mergePartition);
+    double t2 = now();
+
+    /* The top N of every partition are candidates for the global top N. */
+    size_t numDistinct = 0, numCandidates = 0;
+    Element *candidates = malloc((top ? numThreads * top : 1) * sizeof(*candidates));
+    if (!candidates)                                            // if malloc fails
+        exit(-1);
+    for (int t = 0; t < numThreads; t++) {
+        numDistinct += workers[t].parts[t].numElements;
+        memcpy(candidates + numCandidates, workers[t].top, workers[t].numTop * sizeof(*candidates));
+        numCandidates += workers[t].numTop;
+    }
+    qsort(candidates, numCandidates, sizeof(*candidates), compareByCount);
+
+    printf("%zu %zu\n", numKgrams, numDistinct);
+    for (size_t i = 0; i < numCandidates && i < top; i++) {
+        printf("%llu ", candidates[i].count);
+        printEscaped(T + candidates[i].pos, k);
+        printf("\n");
+    }
+    fprintf(stderr, "%d threads: counting %.3f s, merging %.3f s\n", numThreads, t1 - t0, t2 - t1);
+
+    free(candidates);
+    for (int t = 0; t < numThreads; t++) {
+        freeTable(&workers[t].parts[t]);
+        free(workers[t].parts);
+        free(workers[t].top);
+    }
+}
+
+/* Reads the whole file into memory. */
+unsigned char *readFile(const char *name, size_t *len) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *buf = malloc(*len ? *len : 1);
+    if (!buf || fread(buf, 1, *len, f) != *len)
+        exit(-1);
+    fclose(f);
+    return buf;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+/* Usage: kgram_count [-k K] [-n TOP] [-j THREADS] FILE */
+int main(int argc, char *argv[]) {
+    size_t k = K, top = TOP;
+    int numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int a = 1;
+    for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2) {
+        if (!strcmp(argv[a], "-k"))
+            k = (size_t)atol(argv[a + 1]);
+        else if (!strcmp(argv[a], "-n"))
+            top = (size_t)atol(argv[a + 1]);
+        else if (!strcmp(argv[a], "-j"))
+            numThreads = atoi(argv[a + 1]);
+    }
+    if (a >= argc) {
+        fprintf(stderr, "Usage: kgram_count [-k K] [-n TOP] [-j THREADS] FILE\n");
+        return 1;
+    }
+    numThreads = numThreads < 1 ? 1 : numThreads > MAX_THREADS ? MAX_THREADS : numThreads;
+
+    size_t lenT;
+    unsigned char *T = readFile(argv[a], &lenT);
+    countKgrams(T, lenT, k, numThreads, top);
+    free(T);
+    return 0;
+}
+
+/* Test data:
+
+Output is the number of k-grams and the number of distinct k-grams, in the first row,
+and then the most frequent k-grams, with their counts. Ties are in order of first occurence.
+
+Input (printf "abracadabra" > t.txt; kgram_count -k 3 -n 3 t.txt):
+Output:
+9 7
+2 abr
+2 bra
+1 rac
+*/
+
+#endif // KGRAM_COUNT
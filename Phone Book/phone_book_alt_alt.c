@@ -54,6 +54,7 @@ https://en.wikipedia.org/wiki/C_standard_library#Buffer_overflow_vulnerabilities
 #define POWER 31                                                // PRIME == 2**POWER - 1
 #define RATIO 1                                                 // ratio of numQueries (number of inputs) and number of buckets in the hash table - note that there can be many same inputs
 #define MAX_NAME_LEN 16                                         // 15 + 1 for the terminating character
+#define SLAB_SIZE 4096                                          // Number of elements per slab
 
 
 /* HASH TABLE CODE */
@@ -66,6 +67,65 @@ struct Element {
     Element *prev, *next;
 };
 
+/* POOL ALLOCATOR CODE */
+
+/* Elements come from slabs, and erased ones are reused, as in "phone_book.c".
+Every table has its own Pool, which is passed next to the table. */
+
+typedef struct Pool Pool;
+
+struct Pool {
+    Element **slabs;                                            // all elements are in slabs, which are freed at once
+    size_t numSlabs, capSlabs;
+    size_t slabUsed;                                            // number of used elements in the last slab
+    Element *freeList;                                          // erased elements, linked through next
+};
+
+/* Makes an empty pool. */
+void initPool(Pool *pool) {
+    pool->slabs = NULL;
+    pool->numSlabs = pool->capSlabs = 0;
+    pool->slabUsed = SLAB_SIZE;                                 // so that the first element takes a new slab
+    pool->freeList = NULL;
+}
+
+/* Returns a new element: an erased one, from the free list, or the next one in the last slab. */
+Element *allocElement(Pool *pool) {
+    Element *ep = pool->freeList;
+    if (ep) {
+        pool->freeList = ep->next;
+        return ep;
+    }
+    if (pool->slabUsed == SLAB_SIZE) {
+        if (pool->numSlabs == pool->capSlabs) {
+            pool->capSlabs = pool->capSlabs ? pool->capSlabs << 1 : 16;
+            pool->slabs = realloc(pool->slabs, pool->capSlabs * sizeof(*pool->slabs));
+            if (!pool->slabs)                                   // if realloc fails
+                exit(-1);
+        }
+        pool->slabs[pool->numSlabs] = malloc(SLAB_SIZE * sizeof(**pool->slabs));
+        if (!pool->slabs[pool->numSlabs])                       // if malloc fails
+            exit(-1);
+        pool->numSlabs++;
+        pool->slabUsed = 0;
+    }
+    return &pool->slabs[pool->numSlabs - 1][pool->slabUsed++];
+}
+
+/* Puts an erased element on the free list. */
+void freeElement(Pool *pool, Element *ep) {
+    ep->next = pool->freeList;
+    pool->freeList = ep;
+}
+
+/* Frees all slabs, and all elements with them. The pool is empty again. */
+void freePool(Pool *pool) {
+    for (size_t i = 0; i < pool->numSlabs; i++)
+        free(pool->slabs[i]);
+    free(pool->slabs);
+    initPool(pool);
+}
+
 /* Hash function for integers.
 Old-style hash(), the slowest variant.
 Uses integer division (modulo), which is really slow.
@@ -313,13 +373,11 @@ char *find(Element **hashTable, unsigned int mask, int number) {
 If there is the given number already, rewrites the element's name field.
 mask == hashTableSize - 1 (hashTableSize is number of buckets).
 Returns nothing. */
-void insert(Element **hashTable, unsigned int mask, int number, char *name) {
+void insert(Element **hashTable, unsigned int mask, Pool *pool, int number, char *name) {
     Element *ep = NULL;                                         // pointer to Element
     unsigned int hashValue = 0;
     if (!(ep = _find(hashTable, mask, number))) {               // not found
-        ep = malloc(sizeof(*ep));                               // sizeof(Element)
-        if (!ep)                                                // if malloc fails
-            exit(-1);
+        ep = allocElement(pool);
         hashValue = hash(number, mask);
         ep->number = number;
         strcpy(ep->name, name);
@@ -336,7 +394,7 @@ void insert(Element **hashTable, unsigned int mask, int number, char *name) {
 
 /* Erases the element with the given number, if it exists.
 If it doesn't exist, ignores the request. */
-void eraseDoubly(Element **hashTable, unsigned int mask, int number) {
+void eraseDoubly(Element **hashTable, unsigned int mask, Pool *pool, int number) {
     Element *ep = NULL;
     if (!(ep = _find(hashTable, mask, number)))
         return;                                                 // not found
@@ -346,12 +404,12 @@ void eraseDoubly(Element **hashTable, unsigned int mask, int number) {
         ep->prev->next = ep->next;
     if (ep->next)
         ep->next->prev = ep->prev;
-    free(ep);
+    freeElement(pool, ep);
 }
 
 /* Erases the element with the given number, if it exists.
 If it doesn't exist, ignores the request. */
-void erase(Element **hashTable, unsigned int mask, int number) {
+void erase(Element **hashTable, unsigned int mask, Pool *pool, int number) {
     Element *ep = NULL;
     if (!(ep = _find(hashTable, mask, number)))
         return;                                                 // not found
@@ -368,23 +426,16 @@ void erase(Element **hashTable, unsigned int mask, int number) {
             }
         }
     }
-    free(epc);
+    freeElement(pool, epc);
 }
 
 /* Destroys the given hash table.
-hashTableSize is number of buckets. */
-void freeHashTable(Element **hashTable, int hashTableSize) {
-    Element *ep = NULL;                                         // pointer to Element
-    for (int i = 0; i < hashTableSize; i++) {
-        if (hashTable[i]) {
-            Element *epn = NULL;
-            for (ep = hashTable[i]; ep->next != NULL; ep = epn) {
-                epn = ep->next;
-                free(ep);
-            }
-            free(ep);
-        }
-    }
+hashTableSize is number of buckets.
+All of its elements are in its pool, so it frees whole slabs, without walking the chains, and empties the buckets.
+The buckets are still the caller's to free. */
+void freeHashTable(Element **hashTable, int hashTableSize, Pool *pool) {
+    memset(hashTable, 0, hashTableSize * sizeof(*hashTable));
+    freePool(pool);
 }
 
 /* As it name says, calculates and returns the nearest power of two of the input value.
@@ -455,13 +506,16 @@ char **processQueries(Query *queries, int numQueries, int *resLen) {
     const unsigned int mask = contactsSize - 1;
     /* Hash table: dynamic array of contactsSize pointers to Elements - has to be initialized to zeros (NULL pointers). */
     Element **contacts = calloc(contactsSize, sizeof(*contacts));
+    /* Elements of contacts. */
+    Pool pool;
+    initPool(&pool);
 
     for (int i = 0; i < numQueries; i++) {
         if (!(strcmp(queries[i].type, "add"))) {
-            insert(contacts, mask, queries[i].number, queries[i].name);
+            insert(contacts, mask, &pool, queries[i].number, queries[i].name);
         }
         else if (!(strcmp(queries[i].type, "del"))) {
-            eraseDoubly(contacts, mask, queries[i].number);
+            eraseDoubly(contacts, mask, &pool, queries[i].number);
         }
         else {                                                  // queries[i].type == "find"
             char *res = find(contacts, mask, queries[i].number);
@@ -470,7 +524,7 @@ char **processQueries(Query *queries, int numQueries, int *resLen) {
         }
     }
 
-    freeHashTable(contacts, contactsSize);
+    freeHashTable(contacts, contactsSize, &pool);
     free(contacts);
     free(queries);
     return result;
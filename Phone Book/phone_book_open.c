@@ -0,0 +1,361 @@
+//#define PHONE_BOOK_OPEN
+#ifdef PHONE_BOOK_OPEN
+
+/* Phone book with open addressing */
+
+/* The other phone books chain 40-byte Elements with prev and next pointers, and every Element is a separate malloc(),
+so every step of find() is a pointer chase to a random address, which is a cache miss with millions of entries.
+This one keeps number and name inline, in one flat array of 24-byte slots, and resolves collisions by
+linear probing, with the Robin Hood rule: on insert, an element that is farther from its home slot
+takes the slot of an element that is closer to its own, so all probe sequences stay short, even at high load.
+A lookup walks consecutive slots, usually in one or two cache lines, and it can stop at the first slot
+whose element is closer to its home than the probe is, so unsuccessful lookups are short, too.
+erase() uses backward-shift deletion instead of tombstones: following elements are moved one slot back,
+until an empty slot, or an element that is in its home slot, so the table never degrades with deletions.
+
+Hash is multiplicative (Fibonacci hashing): the top bits of number * 2**32 / golden ratio.
+hash() from "phone_book_alt.c" takes the low bits of 32 * x + 1, and with a power-of-two table
+that uses only every 32nd slot as a home, which chains tolerate, but linear probing doesn't.
+
+The table grows (doubles) when it's more than MAX_LOAD_NUM / MAX_LOAD_DEN full.
+Operations have the same semantics as in the other phone books: insert() adds or rewrites a name,
+find() returns the name or "not found", and erase() ignores numbers that aren't there. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_NUM_ITEMS 100000
+#define TRUE 1
+#define FALSE 0
+#define MAX_NAME_LEN 16                                         // 15 + 1 for the terminating character
+#define EMPTY -1                                                // number of an empty slot; phone numbers are non-negative
+#define GOLDEN 2654435769u                                      // 2**32 / golden ratio
+#define MIN_POWER 4                                             // The table has at least 2**MIN_POWER slots.
+#define MAX_LOAD_NUM 7                                          // The table grows when it's more than
+#define MAX_LOAD_DEN 8                                          // MAX_LOAD_NUM / MAX_LOAD_DEN full.
+
+
+/* HASH TABLE CODE */
+
+typedef struct Slot Slot;
+
+struct Slot {
+    int number;                                                 // EMPTY if the slot is empty
+    unsigned int dist;                                          // distance from the home slot of the number
+    char name[MAX_NAME_LEN];
+};
+
+typedef struct OpenTable OpenTable;
+
+struct OpenTable {
+    Slot *slots;
+    unsigned int mask;                                          // number of slots - 1
+    unsigned int power;                                         // number of slots == 2**power
+    unsigned int count;                                         // number of elements
+};
+
+/* Hash function for integers. Home slot of x: the top power bits of x * GOLDEN. */
+unsigned int hash(int x, unsigned int power) {
+    return ((unsigned int)x * GOLDEN) >> (32 - power);
+}
+
+/* Makes an empty table with 2**power slots. */
+void initTable(OpenTable *t, unsigned int power) {
+    t->power = power < MIN_POWER ? MIN_POWER : power;
+    t->mask = (1u << t->power) - 1;
+    t->count = 0;
+    t->slots = malloc(((size_t)t->mask + 1) * sizeof(*t->slots));
+    if (!t->slots)                                              // if malloc fails
+        exit(-1);
+    for (unsigned int i = 0; i <= t->mask; i++)
+        t->slots[i].number = EMPTY;
+}
+
+/* Puts s, which isn't in the table, in its place, by the Robin Hood rule. s.dist must be 0. */
+void place(OpenTable *t, Slot s) {
+    unsigned int i = hash(s.number, t->power);
+    for (;;) {
+        Slot *sp = &t->slots[i];
+        if (sp->number == EMPTY) {
+            *sp = s;
+            return;
+        }
+        if (sp->dist < s.dist) {                                // sp is richer (closer to its home) than s, so s takes its slot, and sp moves on
+            Slot tmp = *sp;
+            *sp = s;
+            s = tmp;
+        }
+        i = (i + 1) & t->mask;
+        s.dist++;
+    }
+}
+
+/* Doubles the number of slots, and puts all elements in their new places. */
+void grow(OpenTable *t) {
+    Slot *old = t->slots;
+    unsigned int oldSize = t->mask + 1;
+    initTable(t, t->power + 1);
+    for (unsigned int i = 0; i < oldSize; i++) {
+        if (old[i].number != EMPTY) {
+            old[i].dist = 0;
+            place(t, old[i]);
+            t->count++;
+        }
+    }
+    free(old);
+}
+
+/* Private function. Used in insert() and erase().
+Returns pointer to the slot with the given number, or NULL. */
+Slot *_find(OpenTable *t, int number) {
+    unsigned int i = hash(number, t->power);
+    for (unsigned int d = 0; ; d++) {
+        Slot *sp = &t->slots[i];
+        if (sp->number == number)
+            return sp;                                          // found
+        if (sp->number == EMPTY || sp->dist < d)                // number would have taken this slot, if it were in the table
+            return NULL;                                        // not found
+        i = (i + 1) & t->mask;
+    }
+}
+
+/* Public function.
+Returns the name, or "not found", as find() in the other phone books. */
+char *find(OpenTable *t, int number) {
+    Slot *sp = _find(t, number);
+    return sp ? sp->name : "not found";
+}
+
+/* Inserts an element if there's no element with the given number.
+If there is the given number already, rewrites the element's name field.
+Returns nothing. */
+void insert(OpenTable *t, int number, char *name) {
+    Slot *sp = NULL;
+    if ((sp = _find(t, number))) {                              // already there
+        strcpy(sp->name, name);
+        return;
+    }
+    if ((unsigned long long)(t->count + 1) * MAX_LOAD_DEN > (unsigned long long)(t->mask + 1) * MAX_LOAD_NUM)
+        grow(t);
+    Slot s;
+    s.number = number;
+    s.dist = 0;
+    strcpy(s.name, name);
+    place(t, s);
+    t->count++;
+}
+
+/* Erases the element with the given number, if it exists.
+If it doesn't exist, ignores the request.
+Backward-shift deletion: moves every following element that isn't in its home slot one slot back. */
+void erase(OpenTable *t, int number) {
+    Slot *sp = NULL;
+    if (!(sp = _find(t, number)))
+        return;                                                 // not found
+    unsigned int i = (unsigned int)(sp - t->slots);
+    unsigned int j = (i + 1) & t->mask;
+    while (t->slots[j].number != EMPTY && t->slots[j].dist) {
+        t->slots[i] = t->slots[j];
+        t->slots[i].dist--;
+        i = j;
+        j = (j + 1) & t->mask;
+    }
+    t->slots[i].number = EMPTY;
+    t->count--;
+}
+
+/* Destroys the given hash table. One free(), since there are no nodes. */
+void freeTable(OpenTable *t) {
+    free(t->slots);
+    t->slots = NULL;
+    t->mask = t->power = t->count = 0;
+}
+
+/* Returns power, such that 2**power slots hold n elements at most MAX_LOAD_NUM / MAX_LOAD_DEN full. */
+unsigned int calculatePower(unsigned int n) {
+    unsigned int power = MIN_POWER;
+    while ((unsigned long long)n * MAX_LOAD_DEN > ((unsigned long long)1 << power) * MAX_LOAD_NUM)
+        power++;
+    return power;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+typedef struct Query Query;
+
+struct Query {
+    char type[5];
+    int number;
+    char name[MAX_NAME_LEN];
+};
+
+Query *readQueries(int *numQueries) {
+    scanf("%d", numQueries);
+    Query *queries = malloc(*numQueries * sizeof(*queries));
+    for (int i = 0; i < *numQueries; i++) {
+        scanf("%s", queries[i].type);
+        scanf("%d", &(queries[i].number));
+        if (!strcmp(queries[i].type, "add"))
+            scanf("%s", queries[i].name);
+    }
+    return queries;
+}
+
+char **processQueries(Query *queries, int numQueries, int *resLen) {
+    /* An array of pointers to strings. Used with memcpy() or strcpy(). */
+    char **result = malloc(numQueries * sizeof(*result));
+    /* A contiguous array of strings (2-D array of chars). Used with memcpy() or strcpy(). */
+    result[0] = calloc(numQueries * MAX_NAME_LEN, sizeof(**result));
+    for (int i = 1; i < numQueries; i++)
+        result[i] = result[0] + i * MAX_NAME_LEN;
+
+    /* Sized for the number of adds, so that it never has to grow. */
+    unsigned int numAdds = 0;
+    for (int i = 0; i < numQueries; i++)
+        numAdds += !strcmp(queries[i].type, "add");
+    OpenTable contacts;
+    initTable(&contacts, calculatePower(numAdds));
+
+    for (int i = 0; i < numQueries; i++) {
+        if (!(strcmp(queries[i].type, "add"))) {
+            insert(&contacts, queries[i].number, queries[i].name);
+        }
+        else if (!(strcmp(queries[i].type, "del"))) {
+            erase(&contacts, queries[i].number);
+        }
+        else {                                                  // queries[i].type == "find"
+            char *res = find(&contacts, queries[i].number);
+            unsigned len = strlen(res);
+            memcpy(result[(*resLen)++], res, len);
+        }
+    }
+
+    freeTable(&contacts);
+    free(queries);
+    return result;
+}
+
+void writeResponses(char **result, int resLen) {
+    for (int i = 0; i < resLen; i++) {
+        printf("%s\n", result[i]);
+    }
+    free(result[0]);
+    free(result);
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Adds n random numbers (up to 9,999,999) to a table that starts small, and has to grow,
+then finds n random numbers, and then deletes all of them, and prints the time of every phase. */
+void benchmark(int n) {
+    int *numbers = malloc(n * sizeof(*numbers));
+    if (!numbers)                                               // if malloc fails
+        exit(-1);
+    srand(1);
+    for (int i = 0; i < n; i++)
+        numbers[i] = (int)(((unsigned)rand() * (RAND_MAX + 1u) + (unsigned)rand()) % 10000000u);
+
+    OpenTable t;
+    initTable(&t, MIN_POWER);
+    double t0 = now();
+    for (int i = 0; i < n; i++)
+        insert(&t, numbers[i], "name");
+    double t1 = now();
+    size_t numFound = 0;
+    for (int i = 0; i < n; i++)
+        numFound += strcmp(find(&t, (int)(((unsigned)rand() * (RAND_MAX + 1u) + (unsigned)rand()) % 10000000u)), "not found") != 0;
+    double t2 = now();
+    unsigned int count = t.count;
+    for (int i = 0; i < n; i++)
+        erase(&t, numbers[i]);
+    double t3 = now();
+
+    printf("%u elements in %u slots: add %.3f s, find %.3f s (%zu found), del %.3f s, %u left\n",
+           count, t.mask + 1, t1 - t0, t2 - t1, numFound, t3 - t2, t.count);
+    freeTable(&t);
+    free(numbers);
+}
+
+
+/* With no arguments, processes queries from stdin, as the other phone books.
+With arguments "bench N", runs benchmark(N). */
+int main(int argc, char *argv[]) {
+    if (argc == 3 && !strcmp(argv[1], "bench")) {
+        benchmark(atoi(argv[2]));
+        return 0;
+    }
+
+    int numQueries = 0;
+    Query *queries = readQueries(&numQueries);
+    int resLen = 0;
+    char **result = processQueries(queries, numQueries, &resLen);
+    writeResponses(result, resLen);
+
+    char c = getchar();
+    c = getchar();
+    return 0;
+}
+
+/* Test data:
+
+First row of input contains number of queries.
+Possible commands are: add, find, del.
+
+Input:
+12
+add 52368 Neo
+add 46213 Mom
+add 911 police
+find 46213
+find 912
+find 911
+del 912
+del 911
+find 911
+find 46213
+add 46213 smith
+find 46213
+
+Output:
+Mom
+not found
+police
+not found
+Mom
+smith
+
+Input:
+8
+find 5558888
+add 654321 me
+add 0 johnny
+find 0
+find 654321
+del 0
+del 0
+find 0
+
+Output:
+not found
+johnny
+me
+not found
+
+Benchmark:
+phone_book_open bench 10000000
+Output (like):
+6321221 elements in 8388608 slots: add 2.696 s, find 2.048 s (6320228 found), del 0.945 s, 0 left
+*/
+
+#endif // PHONE_BOOK_OPEN
@@ -0,0 +1,599 @@
+//#define PHONE_BOOK_SWISS
+#ifdef PHONE_BOOK_SWISS
+
+/* Phone book with a Swiss table */
+
+/* Swiss table (as in Abseil's flat_hash_map): open addressing, with slots in groups of GROUP_SIZE == 16,
+and one control byte per slot, in a separate array. A control byte is EMPTY, DELETED,
+or, for a full slot, a 7-bit tag from the hash of its number. A lookup compares the tag with all 16 control
+bytes of a group at once, with one SSE2 compare, and looks at the slots (number and name) only where the tag matches,
+which is rarely more than the one it's looking for. If the group has an EMPTY slot, the number isn't in the table;
+otherwise the lookup goes on to the next group of the probe sequence (triangular: +1, +2, +3, ... groups).
+That makes the "not found" path cheap: usually one group of control bytes, and no slot at all,
+while a chained find() walks the whole chain, a cache miss per Element, to find out that the number isn't there.
+
+The hash is hash() from "phone_book_alt_alt.c", (32 * x + 1) % (2**31 - 1), with its bit tricks,
+taken whole (with mask == 0xffffffff), and then multiplied by GOLDEN (2**32 / golden ratio), to spread it to all bits:
+the top bits choose the group, and the next 7 bits are the tag. The low bits of 32 * x + 1 alone,
+as the chained table takes them, are always 00001, so they'd make poor tags, and only every 32nd group a home.
+
+erase() marks a slot DELETED (a tombstone, which lookups go past), or EMPTY, if its group already has an EMPTY slot,
+because then no lookup has ever gone past that group. Tombstones are reused by insert(),
+and the table is rebuilt (and doubled, if it's full enough) when full and deleted slots exceed 7/8 of all.
+
+Without SSE2, the control bytes of a group are compared one by one, with the same results.
+
+With "bench N" arguments, finds are timed against find() of the chained table of "phone_book_alt_alt.c",
+which is copied below, with the same N numbers in both tables, under a hit-heavy and a miss-heavy mix of queries. */
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define MAX_NUM_ITEMS 100000
+#define TRUE 1
+#define FALSE 0
+#define PRIME 2147483647u                                       // 2**31 - 1, as in "phone_book_alt_alt.c"
+#define POWER 31                                                // PRIME == 2**POWER - 1
+#define RATIO 1                                                 // ratio of number of elements and number of buckets in the chained hash table
+#define MAX_NAME_LEN 16                                         // 15 + 1 for the terminating character
+#define GROUP_SIZE 16                                           // slots per group == control bytes per SSE2 compare
+#define EMPTY 0x80                                              // control byte of an empty slot
+#define DELETED 0xFE                                            // control byte of a deleted slot (tombstone); full slots have 0x00 - 0x7F (the tag)
+#define GOLDEN 2654435769u                                      // 2**32 / golden ratio
+#define MIN_GROUP_POWER 1                                       // The table has at least 2**MIN_GROUP_POWER groups.
+#define MAX_GROUP_POWER 25                                      // Group index and tag have to fit in 32 bits.
+#define MAX_LOAD_NUM 7                                          // The table is rebuilt when full and deleted slots are more than
+#define MAX_LOAD_DEN 8                                          // MAX_LOAD_NUM / MAX_LOAD_DEN of all.
+#define HIT_HEAVY 90                                            // percentage of finds that hit, in the hit-heavy mix
+#define MISS_HEAVY 10                                           // percentage of finds that hit, in the miss-heavy mix
+
+
+/* HASH FUNCTION CODE */
+
+/* hash() from "phone_book_alt_alt.c": ((x << 5) + 1) % PRIME, for PRIME == 2**31 - 1, without division, & mask. */
+unsigned int hash(unsigned int x, unsigned int mask) {
+    /* Numerator. Phone numbers are 9999999 at most, so this doesn't overflow. */
+    unsigned int n = (x << 5) + 1;
+
+    /* n % PRIME goes into m (modulus) */
+    unsigned int m;
+
+    m = (n & 0x7fffffff) + ((n >> POWER) & 0x7fffffff);
+
+    for (const unsigned int q = 31, r = 0x7fffffff; m > PRIME; ) {
+        m = (m >> q) + (m & r);
+    }
+
+    m = m == PRIME ? 0 : m;
+
+    return m & mask;
+}
+
+
+/* SWISS TABLE CODE */
+
+typedef struct Entry Entry;
+
+struct Entry {
+    int number;
+    char name[MAX_NAME_LEN];
+};
+
+typedef struct SwissTable SwissTable;
+
+struct SwissTable {
+    unsigned char *ctrl;                                        // control bytes, one per slot
+    Entry *entries;                                             // slots
+    unsigned int groupPower;                                    // number of groups == 2**groupPower
+    unsigned int groupMask;                                     // number of groups - 1
+    unsigned int count;                                         // number of full slots
+    unsigned int deleted;                                       // number of DELETED slots
+};
+
+/* Bit i of the result is set if control byte i of the group is equal to c. */
+static inline unsigned int matchByte(const unsigned char *group, unsigned char c) {
+#ifdef USE_SSE2
+    __m128i g = _mm_loadu_si128((const __m128i *)group);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)c)));
+#else
+    unsigned int bits = 0;
+    for (int i = 0; i < GROUP_SIZE; i++)
+        bits |= (unsigned int)(group[i] == c) << i;
+    return bits;
+#endif // USE_SSE2
+}
+
+/* Bit i of the result is set if slot i of the group is EMPTY or DELETED (has the high bit set). */
+static inline unsigned int matchFree(const unsigned char *group) {
+#ifdef USE_SSE2
+    return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    unsigned int bits = 0;
+    for (int i = 0; i < GROUP_SIZE; i++)
+        bits |= (unsigned int)(group[i] >> 7) << i;
+    return bits;
+#endif // USE_SSE2
+}
+
+/* Index of the lowest set bit; bits != 0. */
+static inline unsigned int lowestBit(unsigned int bits) {
+#if defined(__GNUC__)
+    return (unsigned int)__builtin_ctz(bits);
+#else
+    unsigned int i = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/* The hash of number, spread to all 32 bits: hash() with all bits, multiplied by GOLDEN. */
+static inline unsigned int spread(int number) {
+    return hash((unsigned int)number, 0xffffffffu) * GOLDEN;
+}
+
+/* Home group of a spread hash h: its top bits. */
+static inline unsigned int groupOf(const SwissTable *t, unsigned int h) {
+    return h >> (32 - t->groupPower);
+}
+
+/* Tag of a spread hash h: the 7 bits below the group index. */
+static inline unsigned char tagOf(const SwissTable *t, unsigned int h) {
+    return (unsigned char)((h >> (32 - t->groupPower - 7)) & 0x7f);
+}
+
+/* Makes an empty table with 2**groupPower groups. */
+void initSwissTable(SwissTable *t, unsigned int groupPower) {
+    groupPower = groupPower < MIN_GROUP_POWER ? MIN_GROUP_POWER : groupPower;
+    if (groupPower > MAX_GROUP_POWER) {
+        fprintf(stderr, "Swiss table can't have more than 2**%d groups\n", MAX_GROUP_POWER);
+        exit(-1);
+    }
+    size_t numSlots = (size_t)GROUP_SIZE << groupPower;
+    t->groupPower = groupPower;
+    t->groupMask = (1u << groupPower) - 1;
+    t->count = t->deleted = 0;
+    t->ctrl = malloc(numSlots);
+    t->entries = malloc(numSlots * sizeof(*t->entries));
+    if (!t->ctrl || !t->entries)                                // if malloc fails
+        exit(-1);
+    memset(t->ctrl, EMPTY, numSlots);
+}
+
+/* Private function. Used in insert() and erase().
+Returns index of the slot with the given number, or -1. */
+long long _swissFind(const SwissTable *t, int number) {
+    unsigned int h = spread(number);
+    unsigned char tag = tagOf(t, h);
+    unsigned int g = groupOf(t, h);
+    for (unsigned int step = 1; ; step++) {
+        const unsigned char *group = t->ctrl + (size_t)g * GROUP_SIZE;
+        const Entry *entries = t->entries + (size_t)g * GROUP_SIZE;
+        for (unsigned int bits = matchByte(group, tag); bits; bits &= bits - 1) {
+            unsigned int i = lowestBit(bits);
+            if (entries[i].number == number)
+                return (long long)g * GROUP_SIZE + i;           // found
+        }
+        if (matchByte(group, EMPTY))
+            return -1;                                          // not found: it would be in this group, or before it
+        g = (g + step) & t->groupMask;                          // triangular probing visits every group, since their number is a power of two
+    }
+}
+
+/* Public function.
+Returns the name, or "not found", as find() in the other phone books. */
+char *swissFind(SwissTable *t, int number) {
+    long long i = _swissFind(t, number);
+    return i >= 0 ? t->entries[i].name : "not found";
+}
+
+/* Puts number and name in the first free slot of its probe sequence. number isn't in the table. */
+void place(SwissTable *t, int number, const char *name) {
+    unsigned int h = spread(number);
+    unsigned int g = groupOf(t, h);
+    for (unsigned int step = 1; ; step++) {
+        unsigned int bits = matchFree(t->ctrl + (size_t)g * GROUP_SIZE);
+        if (bits) {
+            size_t i = (size_t)g * GROUP_SIZE + lowestBit(bits);
+            t->deleted -= t->ctrl[i] == DELETED;
+            t->ctrl[i] = tagOf(t, h);
+            t->entries[i].number = number;
+            strcpy(t->entries[i].name, name);
+            t->count++;
+            return;
+        }
+        g = (g + step) & t->groupMask;
+    }
+}
+
+/* Rebuilds the table without tombstones, with twice as many groups, if it's more than half full. */
+void rehash(SwissTable *t) {
+    SwissTable old = *t;
+    size_t oldSlots = (size_t)GROUP_SIZE << old.groupPower;
+    initSwissTable(t, old.groupPower + (old.count * 2 > oldSlots));
+    for (size_t i = 0; i < oldSlots; i++)
+        if (!(old.ctrl[i] & 0x80))
+            place(t, old.entries[i].number, old.entries[i].name);
+    free(old.ctrl);
+    free(old.entries);
+}
+
+/* Inserts an element if there's no element with the given number.
+If there is the given number already, rewrites the element's name field.
+Returns nothing. */
+void swissInsert(SwissTable *t, int number, char *name) {
+    long long i = _swissFind(t, number);
+    if (i >= 0) {                                               // already there
+        strcpy(t->entries[i].name, name);
+        return;
+    }
+    size_t numSlots = (size_t)GROUP_SIZE << t->groupPower;
+    if ((size_t)(t->count + t->deleted + 1) * MAX_LOAD_DEN > numSlots * MAX_LOAD_NUM)
+        rehash(t);
+    place(t, number, name);
+}
+
+/* Erases the element with the given number, if it exists.
+If it doesn't exist, ignores the request. */
+void swissErase(SwissTable *t, int number) {
+    long long i = _swissFind(t, number);
+    if (i < 0)
+        return;                                                 // not found
+    const unsigned char *group = t->ctrl + i / GROUP_SIZE * GROUP_SIZE;
+    if (matchByte(group, EMPTY))                                // no lookup has ever gone past this group
+        t->ctrl[i] = EMPTY;
+    else {
+        t->ctrl[i] = DELETED;
+        t->deleted++;
+    }
+    t->count--;
+}
+
+/* Destroys the given hash table. */
+void freeSwissTable(SwissTable *t) {
+    free(t->ctrl);
+    free(t->entries);
+    t->ctrl = NULL;
+    t->entries = NULL;
+    t->count = t->deleted = 0;
+}
+
+/* Returns groupPower, such that 2**groupPower groups hold n elements at most MAX_LOAD_NUM / MAX_LOAD_DEN full. */
+unsigned int calculateGroupPower(unsigned int n) {
+    unsigned int groupPower = MIN_GROUP_POWER;
+    while ((unsigned long long)n * MAX_LOAD_DEN > ((unsigned long long)GROUP_SIZE << groupPower) * MAX_LOAD_NUM)
+        groupPower++;
+    return groupPower;
+}
+
+
+/* CHAINED HASH TABLE CODE, from "phone_book_alt_alt.c", for comparison */
+
+typedef struct Element Element;
+
+struct Element {
+    int number;
+    char name[MAX_NAME_LEN];
+    Element *prev, *next;
+};
+
+/* mask == hashTableSize - 1 (hashTableSize is number of buckets).
+Private function. Used in insert(). */
+Element *_find(Element **hashTable, unsigned int mask, int number) {
+    Element *ep = NULL;                                         // pointer to Element
+    for (ep = hashTable[hash(number, mask)]; ep != NULL; ep = ep->next) {
+        if (ep->number == number)
+            return ep;                                          // found
+    }
+    return NULL;                                                // not found
+}
+
+/* mask == hashTableSize - 1 (hashTableSize is number of buckets).
+Public function. */
+char *find(Element **hashTable, unsigned int mask, int number) {
+    Element *ep = NULL;                                         // pointer to Element
+    for (ep = hashTable[hash(number, mask)]; ep != NULL; ep = ep->next) {
+        if (ep->number == number)
+            return ep->name;                                    // found
+    }
+    return "not found";                                         // not found
+}
+
+/* Inserts an element if there's no element with the given number.
+If there is the given number already, rewrites the element's name field.
+mask == hashTableSize - 1 (hashTableSize is number of buckets).
+Returns nothing. */
+void insert(Element **hashTable, unsigned int mask, int number, char *name) {
+    Element *ep = NULL;                                         // pointer to Element
+    unsigned int hashValue = 0;
+    if (!(ep = _find(hashTable, mask, number))) {               // not found
+        ep = malloc(sizeof(*ep));                               // sizeof(Element)
+        if (!ep)                                                // if malloc fails
+            exit(-1);
+        hashValue = hash(number, mask);
+        ep->number = number;
+        strcpy(ep->name, name);
+        ep->prev = NULL;                                        // this element will be the first one in the bucket
+        ep->next = hashTable[hashValue];                        // always references the first element of the bucket (even if it's a NULL)
+        if (ep->next)
+            ep->next->prev = ep;
+        hashTable[hashValue] = ep;                              // adds this pointer as the first one in the bucket
+    }
+    else {                                                      // already there
+        strcpy(ep->name, name);
+    }
+}
+
+/* Destroys the given hash table.
+hashTableSize is number of buckets. */
+void freeHashTable(Element **hashTable, int hashTableSize) {
+    Element *ep = NULL;                                         // pointer to Element
+    for (int i = 0; i < hashTableSize; i++) {
+        if (hashTable[i]) {
+            Element *epn = NULL;
+            for (ep = hashTable[i]; ep->next != NULL; ep = epn) {
+                epn = ep->next;
+                free(ep);
+            }
+            free(ep);
+        }
+    }
+}
+
+/* Calculates and returns the nearest power of two of the input value, as in "phone_book_alt_alt.c". */
+unsigned int calculateNearestPowerOfTwo(int in) {
+    unsigned int out, inCopy = in;
+    unsigned int smaller, larger;
+    register unsigned int i;
+    for (i = 0; inCopy > 0; i++) {
+        inCopy >>= 1;
+    }
+    smaller = 1 << (i - 1);
+    larger = 1 << i;
+    out = in - smaller < larger - in ? smaller : larger;
+    return out;
+}
+
+
+/* THE EXAMPLE USAGE CODE */
+
+typedef struct Query Query;
+
+struct Query {
+    char type[5];
+    int number;
+    char name[MAX_NAME_LEN];
+};
+
+Query *readQueries(int *numQueries) {
+    scanf("%d", numQueries);
+    Query *queries = malloc(*numQueries * sizeof(*queries));
+    for (int i = 0; i < *numQueries; i++) {
+        scanf("%s", queries[i].type);
+        scanf("%d", &(queries[i].number));
+        if (!strcmp(queries[i].type, "add"))
+            scanf("%s", queries[i].name);
+    }
+    return queries;
+}
+
+char **processQueries(Query *queries, int numQueries, int *resLen) {
+    /* An array of pointers to strings. Used with memcpy() or strcpy(). */
+    char **result = malloc(numQueries * sizeof(*result));
+    /* A contiguous array of strings (2-D array of chars). Used with memcpy() or strcpy(). */
+    result[0] = calloc(numQueries * MAX_NAME_LEN, sizeof(**result));
+    for (int i = 1; i < numQueries; i++)
+        result[i] = result[0] + i * MAX_NAME_LEN;
+
+    /* Sized for the number of adds, so that it has to be rebuilt only because of tombstones. */
+    unsigned int numAdds = 0;
+    for (int i = 0; i < numQueries; i++)
+        numAdds += !strcmp(queries[i].type, "add");
+    SwissTable contacts;
+    initSwissTable(&contacts, calculateGroupPower(numAdds));
+
+    for (int i = 0; i < numQueries; i++) {
+        if (!(strcmp(queries[i].type, "add"))) {
+            swissInsert(&contacts, queries[i].number, queries[i].name);
+        }
+        else if (!(strcmp(queries[i].type, "del"))) {
+            swissErase(&contacts, queries[i].number);
+        }
+        else {                                                  // queries[i].type == "find"
+            char *res = swissFind(&contacts, queries[i].number);
+            unsigned len = strlen(res);
+            memcpy(result[(*resLen)++], res, len);
+        }
+    }
+
+    freeSwissTable(&contacts);
+    free(queries);
+    return result;
+}
+
+void writeResponses(char **result, int resLen) {
+    for (int i = 0; i < resLen; i++) {
+        printf("%s\n", result[i]);
+    }
+    free(result[0]);
+    free(result);
+}
+
+/* Wall-clock time in seconds. */
+double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Random phone number, up to 9,999,999. */
+int randomNumber(void) {
+    return (int)(((unsigned)rand() * (RAND_MAX + 1u) + (unsigned)rand()) % 10000000u);
+}
+
+/* Adds n distinct random numbers to both tables, and then times n finds in each table,
+where hitPercent percent of the finds are numbers that are in the tables, and the others are not. */
+void benchmarkMix(Element **contacts, unsigned int mask, SwissTable *t, const int *numbers, int n, int hitPercent) {
+    int *queries = malloc(n * sizeof(*queries));
+    char *present = calloc(10000000, 1);
+    if (!queries || !present)                                   // if malloc fails
+        exit(-1);
+    for (int i = 0; i < n; i++)
+        present[numbers[i]] = 1;
+    for (int i = 0; i < n; i++) {
+        if (rand() % 100 < hitPercent)
+            queries[i] = numbers[rand() % n];
+        else {
+            int x;
+            while (present[x = randomNumber()])
+                ;
+            queries[i] = x;
+        }
+    }
+
+    size_t foundChained = 0, foundSwiss = 0;
+    double t0 = now();
+    for (int i = 0; i < n; i++)
+        foundChained += strcmp(find(contacts, mask, queries[i]), "not found") != 0;
+    double t1 = now();
+    for (int i = 0; i < n; i++)
+        foundSwiss += strcmp(swissFind(t, queries[i]), "not found") != 0;
+    double t2 = now();
+
+    printf("%3d%% hits: chained find() %.3f s, Swiss find() %.3f s (%zu and %zu found)\n",
+           hitPercent, t1 - t0, t2 - t1, foundChained, foundSwiss);
+    free(present);
+    free(queries);
+}
+
+/* Fills both tables with n distinct random numbers, and runs the hit-heavy and the miss-heavy mix. */
+void benchmark(int n) {
+    if (n < 1 || n > 5000000) {
+        fprintf(stderr, "N should be in [1, 5000000]\n");
+        exit(1);
+    }
+    int *numbers = malloc(n * sizeof(*numbers));
+    char *present = calloc(10000000, 1);
+    if (!numbers || !present)                                   // if malloc fails
+        exit(-1);
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        int x;
+        while (present[x = randomNumber()])
+            ;
+        present[x] = 1;
+        numbers[i] = x;
+    }
+    free(present);
+
+    const unsigned int contactsSize = calculateNearestPowerOfTwo(n <= RATIO ? n : n / RATIO);
+    const unsigned int mask = contactsSize - 1;
+    Element **contacts = calloc(contactsSize, sizeof(*contacts));
+    SwissTable t;
+    initSwissTable(&t, calculateGroupPower(n));
+    if (!contacts)                                              // if calloc fails
+        exit(-1);
+    double t0 = now();
+    for (int i = 0; i < n; i++)
+        insert(contacts, mask, numbers[i], "name");
+    double t1 = now();
+    for (int i = 0; i < n; i++)
+        swissInsert(&t, numbers[i], "name");
+    double t2 = now();
+    printf("%d elements: chained insert() %.3f s, Swiss insert() %.3f s\n", n, t1 - t0, t2 - t1);
+
+    benchmarkMix(contacts, mask, &t, numbers, n, HIT_HEAVY);
+    benchmarkMix(contacts, mask, &t, numbers, n, MISS_HEAVY);
+
+    freeHashTable(contacts, contactsSize);
+    free(contacts);
+    freeSwissTable(&t);
+    free(numbers);
+}
+
+
+/* With no arguments, processes queries from stdin, as the other phone books.
+With arguments "bench N", runs benchmark(N). */
+int main(int argc, char *argv[]) {
+    if (argc == 3 && !strcmp(argv[1], "bench")) {
+        benchmark(atoi(argv[2]));
+        return 0;
+    }
+
+    int numQueries = 0;
+    Query *queries = readQueries(&numQueries);
+    int resLen = 0;
+    char **result = processQueries(queries, numQueries, &resLen);
+    writeResponses(result, resLen);
+
+    char c = getchar();
+    c = getchar();
+    return 0;
+}
+
+/* Test data:
+
+First row of input contains number of queries.
+Possible commands are: add, find, del.
+
+Input:
+12
+add 52368 Neo
+add 46213 Mom
+add 911 police
+find 46213
+find 912
+find 911
+del 912
+del 911
+find 911
+find 46213
+add 46213 smith
+find 46213
+
+Output:
+Mom
+not found
+police
+not found
+Mom
+smith
+
+Input:
+8
+find 5558888
+add 654321 me
+add 0 johnny
+find 0
+find 654321
+del 0
+del 0
+find 0
+
+Output:
+not found
+johnny
+me
+not found
+
+Benchmark:
+phone_book_swiss bench 1000000
+Output (like; chains are long, because hash() & mask is 32 * x + 1, so only every 32nd bucket is used):
+1000000 elements: chained insert() 2.382 s, Swiss insert() 0.070 s
+ 90% hits: chained find() 2.981 s, Swiss find() 0.086 s (900353 and 900353 found)
+ 10% hits: chained find() 4.152 s, Swiss find() 0.031 s (100147 and 100147 found)
+*/
+
+#endif // PHONE_BOOK_SWISS